@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// A fixed-size array whose storage is owned by an Arena.  Syntax classes use
+/// this to hold lists of children (e.g. call arguments) without a separate
+/// heap allocation per node.
+template <typename T>
+class ArenaArray
+{
+  public:
+    /// Construct an empty array.
+    ArenaArray()
+        : m_data( nullptr )
+        , m_size( 0 )
+    {
+    }
+
+    /// Construct an array from storage allocated by an Arena.
+    ArenaArray( T* data, size_t size )
+        : m_data( data )
+        , m_size( size )
+    {
+    }
+
+    size_t size() const { return m_size; }
+
+    bool empty() const { return m_size == 0; }
+
+    T& operator[]( size_t i ) const
+    {
+        assert( i < m_size && "Array index out of range" );
+        return m_data[i];
+    }
+
+    T* begin() const { return m_data; }
+
+    T* end() const { return m_data + m_size; }
+
+  private:
+    T*     m_data;
+    size_t m_size;
+};
+
+
+/// A bump-pointer allocator that owns the syntax of a Program.  Objects are
+/// carved out of large chunks, so nodes that are created together are stored
+/// contiguously, and all of them are freed in one shot when the Arena is
+/// destroyed.  Objects with non-trivial destructors are destroyed (in reverse
+/// order of construction) at that time.
+class Arena
+{
+  public:
+    /// Construct an empty arena.  No memory is reserved until the first allocation.
+    Arena()
+        : m_ptr( nullptr )
+        , m_end( nullptr )
+        , m_bytesUsed( 0 )
+        , m_bytesReserved( 0 )
+        , m_numObjects( 0 )
+    {
+    }
+
+    /// Destroy the arena, running any registered destructors and releasing all chunks.
+    ~Arena()
+    {
+        for( auto it = m_destructors.rbegin(); it != m_destructors.rend(); ++it )
+            it->second( it->first );
+    }
+
+    Arena( const Arena& )            = delete;
+    Arena& operator=( const Arena& ) = delete;
+
+    /// Construct an object of type T in the arena, forwarding the given constructor arguments.
+    template <typename T, typename... Args>
+    T* New( Args&&... args )
+    {
+        T* object = new( Allocate( sizeof( T ), alignof( T ) ) ) T( std::forward<Args>( args )... );
+        if( !std::is_trivially_destructible<T>::value )
+            m_destructors.emplace_back( object, []( void* p ) { static_cast<T*>( p )->~T(); } );
+        ++m_numObjects;
+        return object;
+    }
+
+    /// Copy the given elements into an array allocated in the arena.
+    template <typename T>
+    ArenaArray<T> NewArray( const std::vector<T>& elements )
+    {
+        return newArray( elements.data(), elements.size() );
+    }
+
+    /// Copy the given elements into an array allocated in the arena.
+    template <typename T>
+    ArenaArray<T> NewArray( std::initializer_list<T> elements )
+    {
+        return newArray( elements.begin(), elements.size() );
+    }
+
+    /// Allocate uninitialized storage with the given size and alignment.
+    void* Allocate( size_t size, size_t alignment )
+    {
+        uintptr_t ptr = ( reinterpret_cast<uintptr_t>( m_ptr ) + alignment - 1 ) & ~( alignment - 1 );
+        if( !m_ptr || ptr + size > reinterpret_cast<uintptr_t>( m_end ) )
+        {
+            addChunk( size + alignment );
+            ptr = ( reinterpret_cast<uintptr_t>( m_ptr ) + alignment - 1 ) & ~( alignment - 1 );
+        }
+        m_ptr = reinterpret_cast<char*>( ptr + size );
+        m_bytesUsed += size;
+        return reinterpret_cast<void*>( ptr );
+    }
+
+    /// Get the number of bytes allocated from the arena (excluding alignment padding).
+    size_t GetBytesUsed() const { return m_bytesUsed; }
+
+    /// Get the number of bytes reserved by the arena, including unused space in its chunks.
+    size_t GetBytesReserved() const { return m_bytesReserved; }
+
+    /// Get the number of objects constructed in the arena (excluding arrays).
+    size_t GetNumObjects() const { return m_numObjects; }
+
+    /// Take ownership of the chunks and objects of the given arena, which is left empty.  This allows
+    /// syntax that was allocated in separate arenas (e.g. on separate threads) to be freed together.
+    void Merge( Arena& other )
+    {
+        for( std::unique_ptr<char[]>& chunk : other.m_chunks )
+            m_chunks.push_back( std::move( chunk ) );
+        m_destructors.insert( m_destructors.end(), other.m_destructors.begin(), other.m_destructors.end() );
+        m_bytesUsed += other.m_bytesUsed;
+        m_bytesReserved += other.m_bytesReserved;
+        m_numObjects += other.m_numObjects;
+
+        other.m_chunks.clear();
+        other.m_destructors.clear();
+        other.m_ptr           = nullptr;
+        other.m_end           = nullptr;
+        other.m_bytesUsed     = 0;
+        other.m_bytesReserved = 0;
+        other.m_numObjects    = 0;
+    }
+
+  private:
+    /// Chunks are at least this large.  Larger allocations get a chunk of their own.
+    static constexpr size_t kChunkSize = 64 * 1024;
+
+    using Destructor = void ( * )( void* );
+
+    std::vector<std::unique_ptr<char[]>>      m_chunks;
+    std::vector<std::pair<void*, Destructor>> m_destructors;
+    char*                                     m_ptr;  // next free byte in current chunk
+    char*                                     m_end;  // end of current chunk
+    size_t                                    m_bytesUsed;
+    size_t                                    m_bytesReserved;
+    size_t                                    m_numObjects;
+
+    // Start a new chunk with room for at least the given number of bytes.
+    void addChunk( size_t minSize )
+    {
+        size_t size = minSize > kChunkSize ? minSize : kChunkSize;
+        m_chunks.emplace_back( new char[size] );
+        m_ptr = m_chunks.back().get();
+        m_end = m_ptr + size;
+        m_bytesReserved += size;
+    }
+
+    // Copy the given elements into an array allocated in the arena.  Array
+    // elements are pointers, so no destructors are registered.
+    template <typename T>
+    ArenaArray<T> newArray( const T* elements, size_t size )
+    {
+        static_assert( std::is_trivially_destructible<T>::value, "Arena arrays require trivial element types" );
+        if( size == 0 )
+            return ArenaArray<T>();
+        T* data = static_cast<T*>( Allocate( size * sizeof( T ), alignof( T ) ) );
+        std::uninitialized_copy( elements, elements + size, data );
+        return ArenaArray<T>( data, size );
+    }
+};
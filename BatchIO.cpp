@@ -0,0 +1,219 @@
+#include "BatchIO.h"
+
+#include <llvm/Support/ThreadPool.h>
+
+#include <charconv>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+// Size of the I/O buffers, in bytes.
+const size_t kBufferSize = 64 * 1024;
+
+// Number of inputs processed at a time by RunBatch.
+const size_t kBlockSize = 64 * 1024;
+
+bool isSpace( int c )
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool isDigit( int c )
+{
+    return c >= '0' && c <= '9';
+}
+
+}  // anonymous namespace
+
+IntReader::IntReader( std::FILE* file, bool binary )
+    : m_file( file )
+    , m_binary( binary )
+    , m_error( false )
+    , m_buffer( kBufferSize )
+    , m_pos( 0 )
+    , m_end( 0 )
+{
+}
+
+int IntReader::peek()
+{
+    if( m_pos == m_end )
+    {
+        m_pos = 0;
+        m_end = std::fread( m_buffer.data(), 1, m_buffer.size(), m_file );
+        if( m_end == 0 )
+            return EOF;
+    }
+    return static_cast<unsigned char>( m_buffer[m_pos] );
+}
+
+size_t IntReader::Read( std::vector<int>* values, size_t maxCount )
+{
+    if( m_error )
+        return 0;
+
+    // Binary input is read directly into the vector.  It is read byte by byte (rather than int by
+    // int, which would silently drop a partial int), and a trailing partial integer is an error.
+    if( m_binary )
+    {
+        size_t start = values->size();
+        values->resize( start + maxCount );
+        size_t numBytes = std::fread( values->data() + start, 1, maxCount * sizeof( int ), m_file );
+        size_t count    = numBytes / sizeof( int );
+        values->resize( start + count );
+        if( numBytes % sizeof( int ) != 0 )
+            m_error = true;
+        return count;
+    }
+
+    size_t count = 0;
+    while( count < maxCount )
+    {
+        // Skip whitespace, stopping at the end of the input.
+        int c = peek();
+        while( isSpace( c ) )
+        {
+            ++m_pos;
+            c = peek();
+        }
+        if( c == EOF )
+            break;
+
+        // Parse an optionally signed integer, checking for overflow.
+        bool negative = c == '-';
+        if( c == '-' || c == '+' )
+        {
+            ++m_pos;
+            c = peek();
+        }
+        if( !isDigit( c ) )
+        {
+            m_error = true;
+            return 0;
+        }
+        int64_t value = 0;
+        for( ; isDigit( c ); c = peek() )
+        {
+            value = value * 10 + ( c - '0' );
+            if( value > int64_t( INT32_MAX ) + 1 )
+            {
+                m_error = true;
+                return 0;
+            }
+            ++m_pos;
+        }
+        if( ( c != EOF && !isSpace( c ) ) || ( !negative && value > INT32_MAX ) )
+        {
+            m_error = true;
+            return 0;
+        }
+        values->push_back( static_cast<int>( negative ? -value : value ) );
+        ++count;
+    }
+    return count;
+}
+
+IntWriter::IntWriter( std::FILE* file, bool binary )
+    : m_file( file )
+    , m_binary( binary )
+{
+    m_buffer.reserve( kBufferSize );
+}
+
+void IntWriter::Write( const int* values, size_t count )
+{
+    if( m_binary )
+    {
+        Flush();
+        std::fwrite( values, sizeof( int ), count, m_file );
+        return;
+    }
+
+    // Format each value into the buffer, flushing it when it might not have room for another.
+    const size_t kMaxChars = 12;  // sign, ten digits, and newline
+    for( size_t i = 0; i < count; ++i )
+    {
+        if( m_buffer.size() + kMaxChars > kBufferSize )
+            Flush();
+        char  chars[kMaxChars];
+        char* end = std::to_chars( chars, chars + kMaxChars, values[i] ).ptr;
+        *end++    = '\n';
+        m_buffer.insert( m_buffer.end(), chars, end );
+    }
+}
+
+bool IntWriter::Flush()
+{
+    if( !m_buffer.empty() )
+    {
+        std::fwrite( m_buffer.data(), 1, m_buffer.size(), m_file );
+        m_buffer.clear();
+    }
+    return std::fflush( m_file ) == 0 && !std::ferror( m_file );
+}
+
+int RunBatch( MainFunc mainFunc, BatchFunc batchFunc, IntReader& reader, IntWriter& writer, int numWorkers )
+{
+    // Worker threads (if any) each evaluate a contiguous range of a block, so the results are
+    // written in the same order as the inputs.
+    std::unique_ptr<llvm::DefaultThreadPool> pool;
+    if( numWorkers > 1 )
+        pool.reset( new llvm::DefaultThreadPool( llvm::hardware_concurrency( numWorkers ) ) );
+
+    std::vector<int> inputs;
+    std::vector<int> results;
+    bool             warmedUp = false;
+    inputs.reserve( kBlockSize );
+    while( true )
+    {
+        inputs.clear();
+        size_t count = reader.Read( &inputs, kBlockSize );
+        if( count == 0 )
+            break;
+        results.resize( count );
+
+        auto evaluate = [mainFunc, batchFunc, &inputs, &results]( size_t begin, size_t end ) {
+            if( batchFunc )
+            {
+                batchFunc( inputs.data() + begin, results.data() + begin, static_cast<int>( end - begin ) );
+                return;
+            }
+            for( size_t i = begin; i < end; ++i )
+                results[i] = mainFunc( inputs[i] );
+        };
+        if( !pool )
+            evaluate( 0, count );
+        else
+        {
+            // The first input is evaluated on this thread before the workers start, so that a lazy
+            // JIT compiles the functions it reaches once, rather than in several workers at once.
+            size_t begin = 0;
+            if( !warmedUp )
+            {
+                evaluate( 0, 1 );
+                begin    = 1;
+                warmedUp = true;
+            }
+            size_t numLeft = count - begin;
+            for( int worker = 0; worker < numWorkers; ++worker )
+                pool->async( evaluate, begin + numLeft * worker / numWorkers,
+                             begin + numLeft * ( worker + 1 ) / numWorkers );
+            pool->wait();
+        }
+        writer.Write( results.data(), count );
+    }
+
+    if( reader.HasError() )
+    {
+        std::cerr << "Malformed input" << std::endl;
+        return -1;
+    }
+    if( !writer.Flush() )
+    {
+        std::cerr << "Unable to write results" << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+/// Signature of the compiled main function.
+typedef int ( *MainFunc )( int );
+
+/// Signature of the generated batch entry point, which applies main to n inputs.  \see CodegenBatchEntry
+typedef void ( *BatchFunc )( const int* in, int* out, int n );
+
+/// Reads a stream of integers from a file, either as text (decimal integers separated by
+/// whitespace) or as binary (native-endian 32-bit integers).  Input is buffered, so the
+/// file can be arbitrarily large (e.g. a pipe).
+class IntReader
+{
+  public:
+    /// Construct a reader for the given file, which is not closed by the reader.
+    IntReader( std::FILE* file, bool binary );
+
+    /// Read up to the given number of integers, appending them to the given vector.  Returns the
+    /// number of integers read, which is zero at the end of the input or if an error occurs.
+    size_t Read( std::vector<int>* values, size_t maxCount );
+
+    /// Returns true if the input was malformed.
+    bool HasError() const { return m_error; }
+
+  private:
+    std::FILE*        m_file;
+    bool              m_binary;
+    bool              m_error;
+    std::vector<char> m_buffer;
+    size_t            m_pos;  // position of next char in buffer
+    size_t            m_end;  // end of valid chars in buffer
+
+    // Get the next character without consuming it, refilling the buffer if necessary.
+    // Returns EOF at the end of the input.
+    int peek();
+};
+
+
+/// Writes a stream of integers to a file, either as text (one decimal integer per line) or as
+/// binary (native-endian 32-bit integers).  Output is buffered.
+class IntWriter
+{
+  public:
+    /// Construct a writer for the given file, which is not closed by the writer.
+    IntWriter( std::FILE* file, bool binary );
+
+    /// Flush any buffered output.
+    ~IntWriter() { Flush(); }
+
+    /// Write the given integers.
+    void Write( const int* values, size_t count );
+
+    /// Flush any buffered output.  Returns false if an error occurs.
+    bool Flush();
+
+  private:
+    std::FILE*        m_file;
+    bool              m_binary;
+    std::vector<char> m_buffer;
+};
+
+
+/// Call the given main function on each integer read from the given reader, writing the results
+/// (in order) to the given writer.  Inputs are processed in fixed-size blocks, so memory use is
+/// bounded.  Each block is divided among the given number of worker threads.  If a batch entry
+/// point is given (it may be null), each range of inputs is evaluated with a single call to it,
+/// rather than one call to main per input.  Returns zero for success.
+int RunBatch( MainFunc mainFunc, BatchFunc batchFunc, IntReader& reader, IntWriter& writer, int numWorkers );
@@ -0,0 +1,792 @@
+// weekend_bench: benchmarks the compiler on synthetic programs.  \see ProgramGenerator.h
+//
+// Each result is printed on a line of its own, as a tab-separated name, value and unit, e.g.
+//     compile/functions/O2/parse	12.345	ms
+// Every value is a time (lower is better), taken as the median of several repetitions.  The output
+// can be saved with --output and compared with a later run using --compare, which reports the
+// results that changed by more than a threshold, and exits with a non-zero status if any of them
+// got slower.
+
+#include "Builtins.h"
+#include "CompileStats.h"
+#include "Compiler.h"
+#include "OverloadIndex.h"
+#include "Parser.h"
+#include "Program.h"
+#include "ProgramGenerator.h"
+#include "TokenBuffer.h"
+#include "TokenStream.h"
+#include "Typechecker.h"
+
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Version of the output format, which is written in the header line.
+const int kFormatVersion = 1;
+
+// Command-line options.
+struct Options
+{
+    bool        quick       = false;    // use small programs, e.g. for smoke tests
+    int         repeat      = 5;        // number of repetitions of each measurement
+    std::string filter;                 // run only benchmarks whose names contain this string
+    const char* outputPath  = nullptr;  // also write results to this file
+    const char* comparePath = nullptr;  // compare results with this baseline
+    double      threshold   = 10;       // percentage change reported by --compare
+    const char* generate    = nullptr;  // print a program of this shape, rather than benchmarking
+};
+
+// A named program shape.
+struct NamedShape
+{
+    const char*  name;
+    ProgramShape shape;
+};
+
+// Get the program shapes used by the benchmarks.  Each one stresses a different part of the compiler:
+// many functions, deep expressions, long loops, and heavy overloading.
+std::vector<NamedShape> getShapes( bool quick )
+{
+    std::vector<NamedShape> shapes( 4 );
+    shapes[0].name                  = "functions";
+    shapes[0].shape.numFunctions    = quick ? 20 : 2000;
+    shapes[0].shape.loopIterations  = 10;
+    shapes[1].name                  = "expressions";
+    shapes[1].shape.numFunctions    = quick ? 2 : 20;
+    shapes[1].shape.numStatements   = 4;
+    shapes[1].shape.expressionDepth = quick ? 6 : 12;
+    shapes[2].name                  = "loops";
+    shapes[2].shape.numStatements   = 16;
+    shapes[2].shape.loopIterations  = quick ? 1000 : 100000;
+    shapes[3].name                  = "overloads";
+    shapes[3].shape.numFunctions    = quick ? 10 : 200;
+    shapes[3].shape.numOverloads    = quick ? 10 : 200;
+    return shapes;
+}
+
+// A small program, used to measure the fixed cost of a compilation.
+const char* const kSmallProgram = "int main(int x)\n"
+                                  "{\n"
+                                  "    int sum = 0;\n"
+                                  "    int i = 1;\n"
+                                  "    while (i <= x)\n"
+                                  "    {\n"
+                                  "        sum = sum + i;\n"
+                                  "        i = i + 1;\n"
+                                  "    }\n"
+                                  "    return sum;\n"
+                                  "}\n";
+
+// A branch-free kernel, which the loop vectorizer can apply to several inputs at once.
+const char* const kKernelProgram = "int main(int x)\n"
+                                   "{\n"
+                                   "    int y = x * 3 + 7;\n"
+                                   "    return y - y / 4 + x % 5;\n"
+                                   "}\n";
+
+// A recursive function called behind guards, in both a condition and a boolean variable, which is
+// evaluated only when the guard holds if && is short-circuited.
+const char* const kGuardProgram = "int fib(int n)\n"
+                                  "{\n"
+                                  "    if (n < 2)\n"
+                                  "        return n;\n"
+                                  "    return fib(n - 1) + fib(n - 2);\n"
+                                  "}\n"
+                                  "\n"
+                                  "int main(int x)\n"
+                                  "{\n"
+                                  "    int sum = 0;\n"
+                                  "    int i = 0;\n"
+                                  "    while (i < 100)\n"
+                                  "    {\n"
+                                  "        if (i % 10 == 0 && fib(x + 10) > 0)\n"
+                                  "            sum = sum + 1;\n"
+                                  "        bool found = i % 10 == 5 && fib(x + 10) > 0;\n"
+                                  "        if (found)\n"
+                                  "            sum = sum + 1;\n"
+                                  "        i = i + 1;\n"
+                                  "    }\n"
+                                  "    return sum;\n"
+                                  "}\n";
+
+// The builtin prelude as it was written before the declarations were built from a table (\see
+// BuildBuiltins), which every compilation used to lex, parse and typecheck.
+const char* const kPreludeSource = "int  operator+  ( int x, int y ); "
+                                   "int  operator-  ( int x, int y ); "
+                                   "int  operator*  ( int x, int y ); "
+                                   "int  operator/  ( int x, int y ); "
+                                   "int  operator%  ( int x, int y ); "
+                                   "bool operator== ( int x, int y ); "
+                                   "bool operator!= ( int x, int y ); "
+                                   "bool operator== ( bool x, bool y ); "
+                                   "bool operator!= ( bool x, bool y ); "
+                                   "bool operator<  ( int x, int y ); "
+                                   "bool operator<= ( int x, int y ); "
+                                   "bool operator>  ( int x, int y ); "
+                                   "bool operator>= ( int x, int y ); "
+                                   "bool operator!  ( bool x ); "
+                                   "int  operator-  ( int x ); "
+                                   "bool operator&& ( bool x, bool y ); "
+                                   "bool operator|| ( bool x, bool y ); "
+                                   "bool operator bool ( int x ); "
+                                   "int  operator int  ( bool x ); ";
+
+// Get the elapsed time since the given start time, in milliseconds.
+double millisecondsSince( Clock::time_point start )
+{
+    return std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+}
+
+// Get the median of the given samples.
+double median( std::vector<double> samples )
+{
+    std::sort( samples.begin(), samples.end() );
+    size_t n = samples.size();
+    return n % 2 ? samples[n / 2] : ( samples[n / 2 - 1] + samples[n / 2] ) / 2;
+}
+
+// Collects results, printing each one as it is added.
+class Results
+{
+  public:
+    explicit Results( const Options& options )
+        : m_options( options )
+    {
+        std::cout << header() << std::endl;
+    }
+
+    // Returns true if the benchmarks with the given name (or name prefix) should be run.
+    bool Selected( const std::string& name ) const
+    {
+        return m_options.filter.empty() || name.find( m_options.filter ) != std::string::npos ||
+               m_options.filter.find( name ) != std::string::npos;
+    }
+
+    // Add the median of the given samples as the named result.
+    void Add( const std::string& name, const std::vector<double>& samples, const char* unit )
+    {
+        if( samples.empty() )
+            return;
+        m_results.push_back( Result{ name, median( samples ), unit } );
+        std::cout << format( m_results.back() ) << std::endl;
+    }
+
+    // Write the results to the output file, if any.  Returns false if an error occurs.
+    bool Save() const
+    {
+        if( !m_options.outputPath )
+            return true;
+        std::ofstream out( m_options.outputPath );
+        out << header() << "\n";
+        for( const Result& result : m_results )
+            out << format( result ) << "\n";
+        return bool( out );
+    }
+
+    // Compare the results with the baseline, if any, reporting those that changed by more than the
+    // threshold.  Returns the number of results that got slower, or -1 if the baseline cannot be read.
+    int Compare() const
+    {
+        if( !m_options.comparePath )
+            return 0;
+        std::map<std::string, double> baseline;
+        if( !load( m_options.comparePath, &baseline ) )
+            return -1;
+
+        int numSlower = 0;
+        std::printf( "\n%-48s %12s %12s %9s\n", "Benchmark", "Baseline", "Current", "Change" );
+        for( const Result& result : m_results )
+        {
+            auto it = baseline.find( result.name );
+            if( it == baseline.end() || it->second <= 0 )
+                continue;
+            double change = ( result.value - it->second ) / it->second * 100;
+            if( std::abs( change ) < m_options.threshold )
+                continue;
+            bool slower = change > 0;
+            numSlower += slower;
+            std::printf( "%-48s %12.3f %12.3f %+8.1f%% %s\n", result.name.c_str(), it->second, result.value, change,
+                         slower ? "slower" : "faster" );
+        }
+        std::printf( "%d result(s) more than %.1f%% slower than the baseline\n", numSlower, m_options.threshold );
+        return numSlower;
+    }
+
+  private:
+    struct Result
+    {
+        std::string name;
+        double      value;
+        const char* unit;
+    };
+
+    const Options&      m_options;
+    std::vector<Result> m_results;
+
+    static std::string header()
+    {
+        return "# weekend_bench format " + std::to_string( kFormatVersion );
+    }
+
+    static std::string format( const Result& result )
+    {
+        char value[32];
+        std::snprintf( value, sizeof( value ), "%.6g", result.value );
+        return result.name + "\t" + value + "\t" + result.unit;
+    }
+
+    // Load results from the given file, ignoring comments.
+    static bool load( const char* path, std::map<std::string, double>* results )
+    {
+        std::ifstream in( path );
+        if( !in )
+        {
+            std::cerr << "Unable to read baseline: " << path << std::endl;
+            return false;
+        }
+        std::string line;
+        while( std::getline( in, line ) )
+        {
+            if( line.empty() || line[0] == '#' )
+                continue;
+            std::istringstream fields( line );
+            std::string        name;
+            double             value;
+            if( std::getline( fields, name, '\t' ) && fields >> value )
+                ( *results )[name] = value;
+        }
+        return true;
+    }
+};
+
+// Compile the given source, including the lookup of main (which is when the JIT generates code),
+// returning the elapsed time in milliseconds, or a negative value if an error occurs.
+double timeCompile( Compiler& compiler, const char* source, const char* name,
+                    std::unique_ptr<CompiledProgram>* result = nullptr )
+{
+    Clock::time_point                start   = Clock::now();
+    std::unique_ptr<CompiledProgram> program = compiler.Compile( source, name );
+    if( !program || !program->GetMain() )
+    {
+        std::cerr << "Failed to compile benchmark program: " << name << std::endl;
+        return -1;
+    }
+    double elapsed = millisecondsSince( start );
+    if( result )
+        *result = std::move( program );
+    return elapsed;
+}
+
+// Measure the time taken by the given function, in nanoseconds per call.  The number of calls is
+// chosen so that each repetition takes at least a few milliseconds.
+std::vector<double> timeCalls( const std::function<void()>& function, int repeat )
+{
+    const double kMinMilliseconds = 20;
+    size_t       numCalls         = 1;
+    while( true )
+    {
+        Clock::time_point start = Clock::now();
+        for( size_t i = 0; i < numCalls; ++i )
+            function();
+        if( millisecondsSince( start ) >= kMinMilliseconds || numCalls >= ( size_t( 1 ) << 30 ) )
+            break;
+        numCalls *= 2;
+    }
+
+    std::vector<double> samples;
+    for( int r = 0; r < repeat; ++r )
+    {
+        Clock::time_point start = Clock::now();
+        for( size_t i = 0; i < numCalls; ++i )
+            function();
+        samples.push_back( millisecondsSince( start ) * 1e6 / numCalls );
+    }
+    return samples;
+}
+
+// Benchmark each phase of compiling each program shape at -O0 to -O3, and the run time of the
+// resulting code.
+int benchCompile( const Options& options, Results* results )
+{
+    static const char* const kPhases[] = { "lex", "parse", "typecheck", "simplify", "codegen", "optimize", "jit" };
+    for( const NamedShape& shape : getShapes( options.quick ) )
+    {
+        std::string prefix = std::string( "compile/" ) + shape.name;
+        if( !results->Selected( prefix ) && !results->Selected( std::string( "run/" ) + shape.name ) )
+            continue;
+        std::string source = GenerateProgram( shape.shape );
+        for( int optLevel = 0; optLevel <= 3; ++optLevel )
+        {
+            CompilerOptions compilerOptions;
+            compilerOptions.optLevel     = optLevel;
+            compilerOptions.collectStats = true;
+            Compiler compiler( compilerOptions );
+
+            std::string                                name = prefix + "/O" + std::to_string( optLevel );
+            std::map<std::string, std::vector<double>> phases;
+            std::vector<double>                        totals;
+            std::unique_ptr<CompiledProgram>           program;
+            for( int r = 0; r < options.repeat; ++r )
+            {
+                double total = timeCompile( compiler, source.c_str(), shape.name, &program );
+                if( total < 0 )
+                    return -1;
+                totals.push_back( total );
+                for( const char* phase : kPhases )
+                    phases[phase].push_back( program->GetStats()->GetWallTime( phase ) * 1000 );
+            }
+            for( const char* phase : kPhases )
+                results->Add( name + "/" + phase, phases[phase], "ms" );
+            results->Add( name + "/total", totals, "ms" );
+
+            MainFunc mainFunc = program->GetMain();
+            results->Add( std::string( "run/" ) + shape.name + "/O" + std::to_string( optLevel ),
+                          timeCalls( [mainFunc]() { mainFunc( 7 ); }, options.repeat ), "ns/call" );
+        }
+    }
+    return 0;
+}
+
+// Benchmark the fixed cost of compiling a small program, with a new compiler each time (which
+// constructs the target machine and pass pipelines) and with a reused compiler.
+int benchStartup( const Options& options, Results* results )
+{
+    if( !results->Selected( "startup" ) )
+        return 0;
+    CompilerOptions     compilerOptions;
+    std::vector<double> fresh, reused;
+    for( int r = 0; r < options.repeat; ++r )
+    {
+        Clock::time_point start = Clock::now();
+        Compiler          compiler( compilerOptions );
+        if( timeCompile( compiler, kSmallProgram, "small" ) < 0 )
+            return -1;
+        fresh.push_back( millisecondsSince( start ) );
+    }
+    Compiler compiler( compilerOptions );
+    if( timeCompile( compiler, kSmallProgram, "small" ) < 0 )  // warm up
+        return -1;
+    for( int r = 0; r < options.repeat; ++r )
+    {
+        double elapsed = timeCompile( compiler, kSmallProgram, "small" );
+        if( elapsed < 0 )
+            return -1;
+        reused.push_back( elapsed );
+    }
+    results->Add( "startup/small/fresh-compiler", fresh, "ms" );
+    results->Add( "startup/small/reused-compiler", reused, "ms" );
+    return 0;
+}
+
+// Benchmark the per-compilation cost of the builtin prelude, lexing, parsing and typechecking its
+// source text (as every compilation used to), and constructing it from the signature table.
+int benchPrelude( const Options& options, Results* results )
+{
+    if( !results->Selected( "startup" ) )
+        return 0;
+    auto parsePrelude = []() {
+        TokenStream   tokens( kPreludeSource );
+        Program       program;
+        OverloadIndex noBuiltins;
+        return ParseProgram( tokens, &program ) || Typecheck( program, noBuiltins );
+    };
+    if( parsePrelude() )
+    {
+        std::cerr << "Failed to parse the builtin prelude" << std::endl;
+        return -1;
+    }
+    std::vector<double> parsed = timeCalls( parsePrelude, options.repeat );
+    std::vector<double> table = timeCalls(
+        []() {
+            ProgramPtr    program = BuildBuiltins();
+            OverloadIndex index;
+            for( const FuncDefPtr& funcDef : program->GetFunctions() )
+                index.Insert( funcDef );
+        },
+        options.repeat );
+    results->Add( "startup/prelude/parsed", parsed, "ns/call" );
+    results->Add( "startup/prelude/table", table, "ns/call" );
+    return 0;
+}
+
+// Benchmark the scaling of parallel code generation and optimization (-j).
+int benchThreads( const Options& options, Results* results )
+{
+    if( !results->Selected( "threads" ) )
+        return 0;
+    std::string source = GenerateProgram( getShapes( options.quick )[0].shape );
+    for( int numThreads : { 1, 2, 4, 8 } )
+    {
+        CompilerOptions compilerOptions;
+        compilerOptions.numThreads = numThreads;
+        Compiler            compiler( compilerOptions );
+        std::vector<double> samples;
+        for( int r = 0; r < options.repeat; ++r )
+        {
+            double elapsed = timeCompile( compiler, source.c_str(), "functions" );
+            if( elapsed < 0 )
+                return -1;
+            samples.push_back( elapsed );
+        }
+        results->Add( "threads/functions/j" + std::to_string( numThreads ), samples, "ms" );
+    }
+    return 0;
+}
+
+// Benchmark the time to the first result with eager, lazy and tiered compilation.
+int benchLazy( const Options& options, Results* results )
+{
+    if( !results->Selected( "first-result" ) )
+        return 0;
+    std::string source = GenerateProgram( getShapes( options.quick )[0].shape );
+    for( const char* mode : { "eager", "lazy", "tiered" } )
+    {
+        CompilerOptions compilerOptions;
+        compilerOptions.lazy   = std::string( mode ) == "lazy";
+        compilerOptions.tiered = std::string( mode ) == "tiered";
+        std::vector<double> samples;
+        for( int r = 0; r < options.repeat; ++r )
+        {
+            Compiler                         compiler( compilerOptions );
+            Clock::time_point                start = Clock::now();
+            std::unique_ptr<CompiledProgram> program;
+            if( timeCompile( compiler, source.c_str(), "functions", &program ) < 0 )
+                return -1;
+            program->GetMain()( 1 );
+            samples.push_back( millisecondsSince( start ) );
+        }
+        results->Add( std::string( "first-result/functions/" ) + mode, samples, "ms" );
+    }
+    return 0;
+}
+
+// Benchmark the run time of loop-heavy code generated for a generic CPU and for the host CPU.
+int benchTarget( const Options& options, Results* results )
+{
+    if( !results->Selected( "target" ) )
+        return 0;
+    std::string source = GenerateProgram( getShapes( options.quick )[2].shape );
+    for( const char* cpu : { "generic", "native" } )
+    {
+        CompilerOptions compilerOptions;
+        compilerOptions.optLevel = 3;
+        compilerOptions.cpu      = cpu;
+        Compiler                         compiler( compilerOptions );
+        std::unique_ptr<CompiledProgram> program;
+        if( timeCompile( compiler, source.c_str(), "loops", &program ) < 0 )
+            return -1;
+        MainFunc mainFunc = program->GetMain();
+        std::vector<double> samples = timeCalls( [mainFunc]() { mainFunc( 7 ); }, options.repeat );
+        results->Add( std::string( "target/loops/" ) + cpu, samples, "ns/call" );
+    }
+    return 0;
+}
+
+// Benchmark the run time of recursive calls behind && guards, which are skipped unless the guard holds.
+int benchGuards( const Options& options, Results* results )
+{
+    if( !results->Selected( "guards" ) )
+        return 0;
+    for( int optLevel : { 0, 2 } )
+    {
+        CompilerOptions compilerOptions;
+        compilerOptions.optLevel = optLevel;
+        Compiler                         compiler( compilerOptions );
+        std::unique_ptr<CompiledProgram> program;
+        if( timeCompile( compiler, kGuardProgram, "guards", &program ) < 0 )
+            return -1;
+        MainFunc            mainFunc = program->GetMain();
+        std::vector<double> samples  = timeCalls( [mainFunc]() { mainFunc( 7 ); }, options.repeat );
+        results->Add( "guards/O" + std::to_string( optLevel ), samples, "ns/call" );
+    }
+    return 0;
+}
+
+// Read a file into a null-terminated buffer, copying it with an input stream, as source files were
+// loaded before they were mapped into memory.  Returns zero for success.
+int readAndCopy( const char* path, std::vector<char>* buffer )
+{
+    std::ifstream in( path, std::ifstream::ate | std::ifstream::binary );
+    if( in.fail() )
+        return -1;
+    size_t length = static_cast<size_t>( in.tellg() );
+    buffer->resize( length + 1 );
+    in.seekg( 0, std::ios::beg );
+    in.read( buffer->data(), length );
+    ( *buffer )[length] = '\0';
+    return 0;
+}
+
+// Sum the characters of the given null-terminated source, reading every byte as the lexer would.
+unsigned checksum( const char* source )
+{
+    unsigned sum = 0;
+    for( const char* p = source; *p; ++p )
+        sum += static_cast<unsigned char>( *p );
+    return sum;
+}
+
+// Benchmark loading a large source file, mapping it into memory, and (as a baseline) reading and
+// copying it into a buffer.  Every byte is read, as the lexer would, so that the cost of faulting in
+// the mapped pages is included.
+int benchLoad( const Options& options, Results* results )
+{
+    if( !results->Selected( "load" ) )
+        return 0;
+    ProgramShape shape = getShapes( options.quick )[0].shape;
+    shape.numFunctions *= 10;
+    std::string source = GenerateProgram( shape );
+
+    llvm::SmallString<128> path;
+    int                    fd;
+    if( llvm::sys::fs::createTemporaryFile( "weekend_bench", "w", fd, path ) )
+    {
+        std::cerr << "Unable to create temporary file" << std::endl;
+        return -1;
+    }
+    {
+        llvm::raw_fd_ostream out( fd, true /*shouldClose*/ );
+        out << source;
+    }
+
+    std::vector<double> copied, mapped;
+    unsigned            sum = 0;
+    for( int r = 0; r < options.repeat; ++r )
+    {
+        Clock::time_point start = Clock::now();
+        std::vector<char> copy;
+        if( readAndCopy( path.c_str(), &copy ) )
+        {
+            std::cerr << "Unable to read temporary file" << std::endl;
+            return -1;
+        }
+        sum += checksum( copy.data() );
+        copied.push_back( millisecondsSince( start ) );
+
+        start = Clock::now();
+        std::unique_ptr<llvm::MemoryBuffer> buffer;
+        if( ReadSourceFile( path.c_str(), &buffer ) )
+        {
+            std::cerr << "Unable to read temporary file" << std::endl;
+            return -1;
+        }
+        sum += checksum( buffer->getBufferStart() );
+        mapped.push_back( millisecondsSince( start ) );
+    }
+    llvm::sys::fs::remove( path );
+    if( sum == 0 )
+        std::cerr << "Empty source file" << std::endl;
+    results->Add( "load/functions-x10/copy", copied, "ms" );
+    results->Add( "load/functions-x10/mapped", mapped, "ms" );
+    return 0;
+}
+
+// Benchmark parsing an identifier-heavy program, calling the lexer on demand, reading tokens that
+// were lexed in advance (the time of which is included), and lexing and parsing on several threads.
+int benchParse( const Options& options, Results* results )
+{
+    if( !results->Selected( "parse" ) )
+        return 0;
+    std::string source = GenerateProgram( getShapes( options.quick )[0].shape );
+    for( const char* mode : { "on-demand", "pre-lexed" } )
+    {
+        bool                preLex = std::string( mode ) == "pre-lexed";
+        std::vector<double> samples;
+        for( int r = 0; r < options.repeat; ++r )
+        {
+            Clock::time_point            start = Clock::now();
+            std::unique_ptr<TokenBuffer> buffer( preLex ? new TokenBuffer( source.c_str() ) : nullptr );
+            TokenStream tokens = buffer ? TokenStream( buffer.get() ) : TokenStream( source.c_str() );
+            Program     program;
+            if( ParseProgram( tokens, &program ) )
+                return -1;
+            samples.push_back( millisecondsSince( start ) );
+        }
+        results->Add( std::string( "parse/functions/" ) + mode, samples, "ms" );
+    }
+    for( int numThreads : { 2, 4, 8 } )
+    {
+        std::vector<double> samples;
+        for( int r = 0; r < options.repeat; ++r )
+        {
+            Clock::time_point start = Clock::now();
+            Program           program;
+            if( ParseProgram( source.c_str(), &program, numThreads ) )
+                return -1;
+            samples.push_back( millisecondsSince( start ) );
+        }
+        results->Add( "parse/functions/j" + std::to_string( numThreads ), samples, "ms" );
+    }
+    return 0;
+}
+
+// Benchmark the throughput of the front end on a large program: lexing it into a token buffer, and
+// lexing, parsing and typechecking it (which allocates the syntax tree in the program's arena).
+int benchThroughput( const Options& options, Results* results )
+{
+    if( !results->Selected( "throughput" ) )
+        return 0;
+    ProgramShape shape = getShapes( options.quick )[0].shape;
+    shape.numFunctions *= 10;
+    std::string source = GenerateProgram( shape );
+
+    std::vector<double> lex, frontEnd;
+    for( int r = 0; r < options.repeat; ++r )
+    {
+        Clock::time_point start = Clock::now();
+        TokenBuffer       buffer( source.c_str() );
+        lex.push_back( millisecondsSince( start ) );
+
+        start = Clock::now();
+        TokenStream tokens( source.c_str() );
+        Program     program;
+        if( ParseProgram( tokens, &program ) || Typecheck( program, GetBuiltinIndex() ) )
+            return -1;
+        frontEnd.push_back( millisecondsSince( start ) );
+    }
+    results->Add( "throughput/functions-x10/lex", lex, "ms" );
+    results->Add( "throughput/functions-x10/parse-typecheck", frontEnd, "ms" );
+    return 0;
+}
+
+// Benchmark batch evaluation of a simple kernel, calling main once per input, and calling the
+// vectorizable batch entry point.
+int benchBatch( const Options& options, Results* results )
+{
+    if( !results->Selected( "batch" ) )
+        return 0;
+    CompilerOptions compilerOptions;
+    compilerOptions.optLevel   = 3;
+    compilerOptions.batchEntry = true;
+    Compiler                         compiler( compilerOptions );
+    std::unique_ptr<CompiledProgram> program;
+    if( timeCompile( compiler, kKernelProgram, "kernel", &program ) < 0 )
+        return -1;
+    MainFunc  mainFunc  = program->GetMain();
+    BatchFunc batchFunc = program->GetMainBatch();
+    if( !batchFunc )
+    {
+        std::cerr << "Failed to find main_batch" << std::endl;
+        return -1;
+    }
+
+    // The results are in nanoseconds per input.
+    const int        n = options.quick ? 1 << 16 : 1 << 20;
+    std::vector<int> inputs( n ), outputs( n );
+    for( int i = 0; i < n; ++i )
+        inputs[i] = i - n / 2;
+    auto perInput = []( std::vector<double> samples, int n ) {
+        for( double& sample : samples )
+            sample /= n;
+        return samples;
+    };
+    std::vector<double> scalar = timeCalls(
+        [&]() {
+            for( int i = 0; i < n; ++i )
+                outputs[i] = mainFunc( inputs[i] );
+        },
+        options.repeat );
+    std::vector<double> batch = timeCalls( [&]() { batchFunc( inputs.data(), outputs.data(), n ); }, options.repeat );
+    results->Add( "batch/kernel/scalar", perInput( scalar, n ), "ns/input" );
+    results->Add( "batch/kernel/main_batch", perInput( batch, n ), "ns/input" );
+    return 0;
+}
+
+// Parse command-line options.  Returns false if the command line is malformed.
+bool parseOptions( int argc, const char* const* argv, Options* options )
+{
+    for( int i = 1; i < argc; ++i )
+    {
+        std::string arg( argv[i] );
+        bool        hasValue = i + 1 < argc;
+        if( arg == "--quick" )
+            options->quick = true;
+        else if( arg == "--repeat" && hasValue && atoi( argv[i + 1] ) > 0 )
+            options->repeat = atoi( argv[++i] );
+        else if( arg == "--filter" && hasValue )
+            options->filter = argv[++i];
+        else if( arg == "--output" && hasValue )
+            options->outputPath = argv[++i];
+        else if( arg == "--compare" && hasValue )
+            options->comparePath = argv[++i];
+        else if( arg == "--threshold" && hasValue && atof( argv[i + 1] ) > 0 )
+            options->threshold = atof( argv[++i] );
+        else if( arg == "--generate" && hasValue )
+            options->generate = argv[++i];
+        else
+        {
+            std::cerr << "Invalid option: " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+
+int main( int argc, const char* const* argv )
+{
+    Options options;
+    if( !parseOptions( argc, argv, &options ) )
+    {
+        std::cerr << "Usage: " << argv[0] << " [options]" << std::endl;
+        std::cerr << "  --quick: use small programs" << std::endl;
+        std::cerr << "  --repeat <N>: repeat each measurement N times, reporting the median (default 5)" << std::endl;
+        std::cerr << "  --filter <name>: run only the benchmarks whose names contain the given string" << std::endl;
+        std::cerr << "  --output <file>: also write the results to the given file" << std::endl;
+        std::cerr << "  --compare <file>: compare the results with a baseline written by --output" << std::endl;
+        std::cerr << "  --threshold <percent>: report changes larger than this (default 10)" << std::endl;
+        std::cerr << "  --generate <shape>: print a generated program (functions, expressions, loops, overloads)" << std::endl;
+        return -1;
+    }
+
+    // Print a generated program, e.g. for use with the weekend executable.
+    if( options.generate )
+    {
+        for( const NamedShape& shape : getShapes( options.quick ) )
+        {
+            if( shape.name == std::string( options.generate ) )
+            {
+                std::cout << GenerateProgram( shape.shape );
+                return 0;
+            }
+        }
+        std::cerr << "Unknown shape: " << options.generate << std::endl;
+        return -1;
+    }
+
+    Results results( options );
+    for( auto bench : { benchCompile, benchStartup, benchPrelude, benchThreads, benchLazy, benchTarget, benchGuards,
+                        benchLoad, benchParse, benchThroughput, benchBatch } )
+    {
+        if( bench( options, &results ) )
+            return -1;
+    }
+    if( !results.Save() )
+    {
+        std::cerr << "Unable to write results: " << options.outputPath << std::endl;
+        return -1;
+    }
+    int numSlower = results.Compare();
+    return numSlower == 0 ? 0 : 1;
+}
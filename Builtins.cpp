@@ -0,0 +1,91 @@
+#include "Builtins.h"
+#include "FuncDef.h"
+#include "Intrinsic.h"
+#include "OverloadIndex.h"
+#include "Program.h"
+#include "VarDecl.h"
+
+namespace {
+
+// Signature of a builtin operator, along with the intrinsic opcode that implements it.
+// Builtins take at most two parameters.
+struct BuiltinSig
+{
+    Type        returnType;
+    const char* name;
+    int         numParams;
+    Type        paramTypes[2];
+    Intrinsic   intrinsic;
+};
+
+// Builtin operator signatures.
+constexpr BuiltinSig kBuiltins[] = {
+    // Arithmetic
+    { kTypeInt, "+", 2, { kTypeInt, kTypeInt }, kIntrinsicAdd },
+    { kTypeInt, "-", 2, { kTypeInt, kTypeInt }, kIntrinsicSub },
+    { kTypeInt, "*", 2, { kTypeInt, kTypeInt }, kIntrinsicMul },
+    { kTypeInt, "/", 2, { kTypeInt, kTypeInt }, kIntrinsicDiv },
+    { kTypeInt, "%", 2, { kTypeInt, kTypeInt }, kIntrinsicMod },
+    // Equality
+    { kTypeBool, "==", 2, { kTypeInt, kTypeInt }, kIntrinsicEQ },
+    { kTypeBool, "!=", 2, { kTypeInt, kTypeInt }, kIntrinsicNE },
+    { kTypeBool, "==", 2, { kTypeBool, kTypeBool }, kIntrinsicEQ },
+    { kTypeBool, "!=", 2, { kTypeBool, kTypeBool }, kIntrinsicNE },
+    // Comparisons
+    { kTypeBool, "<", 2, { kTypeInt, kTypeInt }, kIntrinsicLT },
+    { kTypeBool, "<=", 2, { kTypeInt, kTypeInt }, kIntrinsicLE },
+    { kTypeBool, ">", 2, { kTypeInt, kTypeInt }, kIntrinsicGT },
+    { kTypeBool, ">=", 2, { kTypeInt, kTypeInt }, kIntrinsicGE },
+    // Unary operations.
+    { kTypeBool, "!", 1, { kTypeBool }, kIntrinsicNot },
+    { kTypeInt, "-", 1, { kTypeInt }, kIntrinsicNeg },
+    // Logical operations
+    { kTypeBool, "&&", 2, { kTypeBool, kTypeBool }, kIntrinsicAnd },
+    { kTypeBool, "||", 2, { kTypeBool, kTypeBool }, kIntrinsicOr },
+    // Type conversions
+    { kTypeBool, "bool", 1, { kTypeInt }, kIntrinsicIntToBool },
+    { kTypeInt, "int", 1, { kTypeBool }, kIntrinsicBoolToInt },
+};
+
+} // anonymous namespace
+
+// Construct builtin function declarations from the signature table.
+ProgramPtr BuildBuiltins()
+{
+    static const char* const kParamNames[] = { "x", "y" };
+
+    ProgramPtr program( new Program );
+    Arena&     arena = program->GetArena();
+    program->GetFunctions().reserve( sizeof( kBuiltins ) / sizeof( kBuiltins[0] ) );
+    for( const BuiltinSig& sig : kBuiltins )
+    {
+        std::vector<VarDeclPtr> params;
+        for( int i = 0; i < sig.numParams; ++i )
+            params.push_back(
+                arena.New<VarDecl>( VarDecl::kParam, sig.paramTypes[i], Symbol::Intern( kParamNames[i] ) ) );
+        program->GetFunctions().push_back( arena.New<FuncDef>( sig.returnType, Symbol::Intern( sig.name ),
+                                                                 arena.NewArray( params ), nullptr /*body*/,
+                                                                 sig.intrinsic ) );
+    }
+    return program;
+}
+
+// Get builtin function declarations, constructing them on first use.  (Initialization of a
+// function-local static is thread safe.)
+const Program& GetBuiltins()
+{
+    static const ProgramPtr builtins( BuildBuiltins() );
+    return *builtins;
+}
+
+// Get an index of the builtin function declarations, constructing it on first use.
+const OverloadIndex& GetBuiltinIndex()
+{
+    static const std::unique_ptr<OverloadIndex> index( [] {
+        std::unique_ptr<OverloadIndex> index( new OverloadIndex );
+        for( const FuncDefPtr& funcDef : GetBuiltins().GetFunctions() )
+            index->Insert( funcDef );
+        return index;
+    }() );
+    return *index;
+}
@@ -1,33 +1,19 @@
 #pragma once
 
-// Get builtin function declarations (for typechecking purposes).
-inline const char* GetBuiltins()
-{
-    return
-        // Arithmetic
-        "int  operator+  ( int x, int y ); "
-        "int  operator-  ( int x, int y ); "
-        "int  operator*  ( int x, int y ); "
-        "int  operator/  ( int x, int y ); "
-        "int  operator%  ( int x, int y ); "
-        // Equality
-        "bool operator== ( int x, int y ); "
-        "bool operator!= ( int x, int y ); "
-        "bool operator== ( bool x, bool y ); "
-        "bool operator!= ( bool x, bool y ); "
-        // Comparisons
-        "bool operator<  ( int x, int y ); "
-        "bool operator<= ( int x, int y ); "
-        "bool operator>  ( int x, int y ); "
-        "bool operator>= ( int x, int y ); "
-        // Unary operations.
-        "bool operator!  ( bool x ); "
-        "int  operator-  ( int x ); "
-        // Logical operations
-        "bool operator&& ( bool x, bool y ); "
-        "bool operator|| ( bool x, bool y ); "
-        // Type conversions
-        "bool operator bool ( int x ); "
-        "int  operator int  ( bool x ); "
-        ;
-}
+#include "Syntax.h"
+
+class OverloadIndex;
+
+/// Get builtin function declarations (for typechecking purposes).  The declarations are
+/// constructed from a static table on first use, and the resulting Program is shared by all
+/// subsequent compilations, so the builtin prelude is never lexed or parsed.
+const Program& GetBuiltins();
+
+/// Construct a new copy of the builtin function declarations from the static table.  GetBuiltins()
+/// calls this once; it is exposed so that the cost of constructing the prelude can be measured.
+ProgramPtr BuildBuiltins();
+
+/// Get an index of the builtin function declarations, which is built on first use and shared by
+/// all subsequent compilations.  It serves as the parent of the index of each program's functions.
+/// \see OverloadIndex
+const OverloadIndex& GetBuiltinIndex();
@@ -10,19 +10,73 @@
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/Support/raw_ostream.h>
-#include <map>
+#include <string>
+#include <vector>
 
 using namespace llvm;
 
-// The symbol table maps variable declarations to LLVM values.  Local variables are mapped to alloca
-// pointers, while function parameters are mapped to their LLVM equivalents.
-using SymbolTable = std::map<const VarDecl*, Value*>;
-
-// The function table maps function definitions to their LLVM equivalents.
-using FunctionTable = std::map<const FuncDef*, Function*>;
+// The symbol table maps variable declarations to LLVM values.  It is indexed by the slot of each
+// variable, which the typechecker numbered densely within each function (\see VarDecl::GetSlot).
+// Local variables are mapped to alloca pointers, while function parameters are mapped to their
+// LLVM equivalents.
+using SymbolTable = std::vector<Value*>;
 
 namespace {
 
+// The function table maps function definitions to their LLVM equivalents.  It is indexed by the
+// position of each function in the program, which the typechecker recorded (\see FuncDef::GetIndex).
+// When a program is split into several modules (\see Codegen), a function might be called from a
+// module other than the one that defines it, so functions are given names that are unique
+// program-wide: the source name followed by the function's position in the program.  (The first
+// main function keeps its name, so that the JIT can find it.)
+class FunctionTable
+{
+  public:
+    // Construct an empty function table for the given program, optionally assigning unique names
+    // to its functions.
+    FunctionTable( const Program& program, bool uniqueNames )
+        : m_functions( program.GetFunctions().size() )
+        , m_uniqueNames( uniqueNames )
+        , m_main( nullptr )
+    {
+        for( const FuncDefPtr& funcDef : program.GetFunctions() )
+        {
+            if( funcDef->GetName().ToString() == "main" )
+            {
+                m_main = funcDef;
+                break;
+            }
+        }
+    }
+
+    // Get the LLVM function for the given function definition, or null if it has not been declared.
+    Function* Find( const FuncDef* funcDef ) const { return m_functions[getIndex( funcDef )]; }
+
+    // Record the LLVM function for the given function definition.
+    void Insert( const FuncDef* funcDef, Function* function ) { m_functions[getIndex( funcDef )] = function; }
+
+    // Get the name of the LLVM function for the given function definition.
+    std::string GetName( const FuncDef* funcDef ) const
+    {
+        if( !m_uniqueNames || funcDef == m_main )
+            return funcDef->GetName().ToString();
+        return funcDef->GetName().ToString() + "." + std::to_string( funcDef->GetIndex() );
+    }
+
+  private:
+    std::vector<Function*> m_functions;
+    bool                   m_uniqueNames;
+    const FuncDef*         m_main;
+
+    // Get the position of the given function definition in the program.
+    size_t getIndex( const FuncDef* funcDef ) const
+    {
+        assert( funcDef->GetIndex() >= 0 && size_t( funcDef->GetIndex() ) < m_functions.size() &&
+                "Function was not numbered by the typechecker" );
+        return funcDef->GetIndex();
+    }
+};
+
 // Base class for expression and statement code generators, which holds the LLVM context, module,
 // and IR builder, providing various helper routines.
 class CodegenBase
@@ -72,6 +126,32 @@ class CodegenBase
     // Generate LLVM IR for a constant integer.
     Constant* GetInt( int i ) const { return ConstantInt::get( GetIntType(), i, true /*isSigned*/ ); }
 
+    // Create a basic block that follows the block at the builder's insertion point (rather than going at
+    // the end of the function), so the blocks for nested control flow are laid out in source order.
+    BasicBlock* CreateBlock( const char* name )
+    {
+        BasicBlock* current = GetBuilder()->GetInsertBlock();
+        return BasicBlock::Create( *GetContext(), name, current->getParent(), current->getNextNode() );
+    }
+
+    // Declare an LLVM function for the given function definition, with the given name and linkage.
+    Function* DeclareFunction( const FuncDef* funcDef, const std::string& name, Function::LinkageTypes linkage )
+    {
+        // Convert parameter types to LLVM types.
+        const ArenaArray<VarDeclPtr>& params = funcDef->GetParams();
+        std::vector<llvm::Type*> paramTypes;
+        paramTypes.reserve( params.size() );
+        for( const VarDeclPtr& param : params )
+        {
+            paramTypes.push_back( ConvertType( param->GetType() ) );
+        }
+
+        // Construct LLVM function type and function declaration.
+        llvm::Type*   returnType = ConvertType( funcDef->GetReturnType() );
+        FunctionType* funcType   = FunctionType::get( returnType, paramTypes, false /*isVarArg*/ );
+        return Function::Create( funcType, linkage, name, GetModule() );
+    }
+
   protected:
     LLVMContext* m_context;
     Module*      m_module;
@@ -108,9 +188,8 @@ class CodegenExp : public ExpVisitor, CodegenBase
         assert( varDecl );
 
         // An llvm::Value was associated with the variable when its declaration was processed.
-        SymbolTable::const_iterator it = m_symbols->find( varDecl );
-        assert( it != m_symbols->end() );
-        Value* value = it->second;
+        Value* value = ( *m_symbols )[varDecl->GetSlot()];
+        assert( value );
 
         // The value is either a function parameter or a pointer to storage for a local variable.
         switch( varDecl->GetKind() )
@@ -118,7 +197,7 @@ class CodegenExp : public ExpVisitor, CodegenBase
             case VarDecl::kParam:
                 return value;
             case VarDecl::kLocal:
-                return GetBuilder()->CreateLoad( ConvertType(varDecl->GetType()), value, varDecl->GetName() );
+                return GetBuilder()->CreateLoad( ConvertType(varDecl->GetType()), value, varDecl->GetName().ToString() );
         }
         assert(false && "unreachable");
         return nullptr;
@@ -127,6 +206,10 @@ class CodegenExp : public ExpVisitor, CodegenBase
     // Generate code for a function call.
     void* Visit( CallExp& exp ) override
     {
+        // The second operand of && and || is evaluated conditionally.
+        if( exp.GetIntrinsic() == kIntrinsicAnd || exp.GetIntrinsic() == kIntrinsicOr )
+            return codegenShortCircuit( exp );
+
         // Convert the arguments to LLVM values.
         std::vector<Value*> args;
         args.reserve( exp.GetArgs().size() );
@@ -135,63 +218,189 @@ class CodegenExp : public ExpVisitor, CodegenBase
             args.push_back( Codegen( *arg ) );
         }
 
-        // Builtin definition?  TODO: use an enum for builtin functions, rather than matching the name.
-        const std::string& funcName = exp.GetFuncName();
-        if( funcName == "+" )
-            return GetBuilder()->CreateAdd( args.at( 0 ), args.at( 1 ) );
-        else if( funcName == "-" )
-        {
-            if( args.size() == 1 )
-                return GetBuilder()->CreateNeg( args.at( 0 ) );
-            else
-                return GetBuilder()->CreateSub( args.at( 0 ), args.at( 1 ) );
-        }
-        else if( funcName == "*" )
-            return GetBuilder()->CreateMul( args.at( 0 ), args.at( 1 ) );
-        else if( funcName == "/" )
-            return GetBuilder()->CreateSDiv( args.at( 0 ), args.at( 1 ) );
-        else if( funcName == "%" )
-            return GetBuilder()->CreateSRem( args.at( 0 ), args.at( 1 ) );
-        else if( funcName == "==" )
-            return GetBuilder()->CreateICmpEQ( args.at( 0 ), args.at( 1 ) );
-        else if( funcName == "!=" )
-            return GetBuilder()->CreateICmpNE( args.at( 0 ), args.at( 1 ) );
-        else if( funcName == "<" )
-            return GetBuilder()->CreateICmpSLT( args.at( 0 ), args.at( 1 ) );
-        else if( funcName == "<=" )
-            return GetBuilder()->CreateICmpSLE( args.at( 0 ), args.at( 1 ) );
-        else if( funcName == ">" )
-            return GetBuilder()->CreateICmpSGT( args.at( 0 ), args.at( 1 ) );
-        else if( funcName == ">=" )
-            return GetBuilder()->CreateICmpSGE( args.at( 0 ), args.at( 1 ) );
-        else if( funcName == "!" )
-            return GetBuilder()->CreateICmpEQ( args.at( 0 ), GetBool( false ) );
-        else if( funcName == "bool" )
-            return GetBuilder()->CreateICmpNE( args.at( 0 ), GetInt( 0 ) );
-        else if( funcName == "int" )
-            return GetBuilder()->CreateZExt( args.at( 0 ), GetIntType() );
-        // TODO: proper short-circuiting for && and ||.
-        else if (funcName == "&&")
-            return GetBuilder()->CreateSelect( args.at( 0 ), args.at( 1 ), GetBool( false ) );
-        else if (funcName == "||")
-            return GetBuilder()->CreateSelect( args.at( 0 ), GetBool( true ), args.at( 1 ) );
+        // Calls to builtin functions were tagged with an intrinsic opcode by the typechecker.
+        if( exp.GetIntrinsic() != kIntrinsicNone )
+            return codegenIntrinsic( exp.GetIntrinsic(), args );
 
         // The typechecker linked function call sites to their definitions.
         const FuncDef* funcDef = exp.GetFuncDef();
         assert( funcDef );
 
-        // An llvm::Function was associated with the function when its definition was processed.
-        FunctionTable::const_iterator it = m_functions->find( funcDef );
-        assert( it != m_functions->end() );
-        Function* function = it->second;
+        // An llvm::Function was associated with the function when it was declared.  If it's not
+        // found, the function is defined in another module, so an external declaration is created.
+        Function* function = m_functions->Find( funcDef );
+        if( !function )
+        {
+            function = DeclareFunction( funcDef, m_functions->GetName( funcDef ), Function::ExternalLinkage );
+            m_functions->Insert( funcDef, function );
+        }
 
         // Generate LLVM function call.
-        return GetBuilder()->CreateCall( function->getFunctionType(), function, args, funcDef->GetName() );
+        return GetBuilder()->CreateCall( function->getFunctionType(), function, args, funcDef->GetName().ToString() );
     }
 
   private:
     SymbolTable* m_symbols;
     FunctionTable* m_functions;
+
+    // Generate code for && or ||, which evaluates its second operand only if the first one does not
+    // determine the result.  The result is a phi of the first operand's value (false for &&, true for
+    // ||) when the second operand is skipped and the second operand's value otherwise.
+    Value* codegenShortCircuit( const CallExp& exp )
+    {
+        bool        isAnd     = exp.GetIntrinsic() == kIntrinsicAnd;
+        BasicBlock* joinBlock = CreateBlock( isAnd ? "and.join" : "or.join" );
+        BasicBlock* rhsBlock  = CreateBlock( isAnd ? "and.rhs" : "or.rhs" );
+
+        // Generate code for the first operand and branch on it.  The operand might contain control
+        // flow of its own, so the phi's predecessor is whichever block the operand ends in.
+        Value*      lhs      = Codegen( *exp.GetArgs()[0] );
+        BasicBlock* lhsBlock = GetBuilder()->GetInsertBlock();
+        if( isAnd )
+            GetBuilder()->CreateCondBr( lhs, rhsBlock, joinBlock );
+        else
+            GetBuilder()->CreateCondBr( lhs, joinBlock, rhsBlock );
+
+        // Generate code for the second operand, followed by an unconditional branch to the join point.
+        GetBuilder()->SetInsertPoint( rhsBlock );
+        Value* rhs = Codegen( *exp.GetArgs()[1] );
+        rhsBlock   = GetBuilder()->GetInsertBlock();
+        GetBuilder()->CreateBr( joinBlock );
+
+        GetBuilder()->SetInsertPoint( joinBlock );
+        PHINode* result = GetBuilder()->CreatePHI( GetBoolType(), 2, isAnd ? "and" : "or" );
+        result->addIncoming( GetBool( !isAnd ), lhsBlock );
+        result->addIncoming( rhs, rhsBlock );
+        return result;
+    }
+
+    // Generate code for a builtin operation, given its (already generated) arguments.
+    Value* codegenIntrinsic( ::Intrinsic intrinsic, const std::vector<Value*>& args )
+    {
+        switch( intrinsic )
+        {
+            case kIntrinsicAdd:
+                return GetBuilder()->CreateAdd( args[0], args[1] );
+            case kIntrinsicSub:
+                return GetBuilder()->CreateSub( args[0], args[1] );
+            case kIntrinsicMul:
+                return GetBuilder()->CreateMul( args[0], args[1] );
+            case kIntrinsicDiv:
+                return GetBuilder()->CreateSDiv( args[0], args[1] );
+            case kIntrinsicMod:
+                return GetBuilder()->CreateSRem( args[0], args[1] );
+            case kIntrinsicNeg:
+                return GetBuilder()->CreateNeg( args[0] );
+            case kIntrinsicEQ:
+                return GetBuilder()->CreateICmpEQ( args[0], args[1] );
+            case kIntrinsicNE:
+                return GetBuilder()->CreateICmpNE( args[0], args[1] );
+            case kIntrinsicLT:
+                return GetBuilder()->CreateICmpSLT( args[0], args[1] );
+            case kIntrinsicLE:
+                return GetBuilder()->CreateICmpSLE( args[0], args[1] );
+            case kIntrinsicGT:
+                return GetBuilder()->CreateICmpSGT( args[0], args[1] );
+            case kIntrinsicGE:
+                return GetBuilder()->CreateICmpSGE( args[0], args[1] );
+            case kIntrinsicNot:
+                return GetBuilder()->CreateICmpEQ( args[0], GetBool( false ) );
+            case kIntrinsicIntToBool:
+                return GetBuilder()->CreateICmpNE( args[0], GetInt( 0 ) );
+            case kIntrinsicBoolToInt:
+                return GetBuilder()->CreateZExt( args[0], GetIntType() );
+            case kIntrinsicAnd:
+            case kIntrinsicOr:
+                break;  // \see codegenShortCircuit
+            case kIntrinsicNone:
+                break;
+        }
+        assert( false && "Unhandled intrinsic" );
+        return nullptr;
+    }
+};
+
+
+// Condition code generator, which generates a conditional branch on the condition expression of an
+// "if" statement or a while loop.  Rather than materializing a boolean, the operands of && and || are
+// branched on individually, skipping the second operand when the first one determines the result,
+// and ! swaps the branch targets.
+class CodegenCond : public ExpVisitor, CodegenBase
+{
+  public:
+    CodegenCond( LLVMContext* context, Module* module, IRBuilder<>* builder, CodegenExp* codegenExp )
+        : CodegenBase( context, module, builder )
+        , m_codegenExp( codegenExp )
+        , m_trueBlock( nullptr )
+        , m_falseBlock( nullptr )
+    {
+    }
+
+    // Generate a branch to one of the given blocks, depending on the given expression.  The
+    // visitor operates on non-const expressions, so we must const_cast when dispatching.
+    void Codegen( const Exp& exp, BasicBlock* trueBlock, BasicBlock* falseBlock )
+    {
+        m_trueBlock  = trueBlock;
+        m_falseBlock = falseBlock;
+        const_cast<Exp&>( exp ).Dispatch( *this );
+    }
+
+    void* Visit( BoolExp& exp ) override { return codegenBranch( exp ); }
+
+    void* Visit( IntExp& exp ) override { return codegenBranch( exp ); }
+
+    void* Visit( VarExp& exp ) override { return codegenBranch( exp ); }
+
+    void* Visit( CallExp& exp ) override
+    {
+        // The branch targets are copied, since nested conditions overwrite them.
+        BasicBlock* trueBlock  = m_trueBlock;
+        BasicBlock* falseBlock = m_falseBlock;
+        const ArenaArray<ExpPtr>& args = exp.GetArgs();
+        switch( exp.GetIntrinsic() )
+        {
+            case kIntrinsicAnd:
+            {
+                BasicBlock* rhsBlock = CreateBlock( "and.rhs" );
+                Codegen( *args[0], rhsBlock, falseBlock );
+                GetBuilder()->SetInsertPoint( rhsBlock );
+                Codegen( *args[1], trueBlock, falseBlock );
+                return nullptr;
+            }
+            case kIntrinsicOr:
+            {
+                BasicBlock* rhsBlock = CreateBlock( "or.rhs" );
+                Codegen( *args[0], trueBlock, rhsBlock );
+                GetBuilder()->SetInsertPoint( rhsBlock );
+                Codegen( *args[1], trueBlock, falseBlock );
+                return nullptr;
+            }
+            case kIntrinsicNot:
+                Codegen( *args[0], falseBlock, trueBlock );
+                return nullptr;
+            default:
+                return codegenBranch( exp );
+        }
+    }
+
+  private:
+    CodegenExp* m_codegenExp;
+    BasicBlock* m_trueBlock;
+    BasicBlock* m_falseBlock;
+
+    // Generate code for the value of the given expression and branch on it.
+    void* codegenBranch( const Exp& exp )
+    {
+        Value* condition = m_codegenExp->Codegen( exp );
+
+        // Convert an integer condition to a boolean (i1) using a comparison.
+        if( exp.GetType() == kTypeInt )
+            condition = GetBuilder()->CreateICmpNE( condition, GetInt( 0 ) );
+        assert( exp.GetType() == kTypeBool || exp.GetType() == kTypeInt );
+
+        GetBuilder()->CreateCondBr( condition, m_trueBlock, m_falseBlock );
+        return nullptr;
+    }
 };
 
 
@@ -206,6 +415,7 @@ class CodegenStmt : public StmtVisitor, CodegenBase
         , m_functions( functions )
         , m_currentFunction( currentFunction )
         , m_codegenExp( context, module, builder, symbols, functions )
+        , m_codegenCond( context, module, builder, &m_codegenExp )
     {
     }
 
@@ -233,9 +443,8 @@ class CodegenStmt : public StmtVisitor, CodegenBase
         assert( varDecl && varDecl->GetKind() == VarDecl::kLocal );
 
         // The symbol table maps local variables to stack-allocated storage.
-        SymbolTable::const_iterator it = m_symbols->find( varDecl );
-        assert( it != m_symbols->end() );
-        Value* location = it->second;
+        Value* location = ( *m_symbols )[varDecl->GetSlot()];
+        assert( location );
 
         // Generate code for the rvalue and store it.
         Value* rvalue = m_codegenExp.Codegen( stmt.GetRvalue() );
@@ -252,10 +461,10 @@ class CodegenStmt : public StmtVisitor, CodegenBase
         // Generate an "alloca" instruction, which goes in entry block of the current function.
         IRBuilder<> allocaBuilder( &m_currentFunction->getEntryBlock(),
                                    m_currentFunction->getEntryBlock().getFirstInsertionPt() );
-        Value* location = allocaBuilder.CreateAlloca( type, nullptr /*arraySize*/, varDecl->GetName() );
+        Value* location = allocaBuilder.CreateAlloca( type, nullptr /*arraySize*/, varDecl->GetName().ToString() );
 
         // Store the variable location in the symbol table.
-        m_symbols->insert( SymbolTable::value_type( varDecl, location ) );
+        ( *m_symbols )[varDecl->GetSlot()] = location;
 
         // Generate code for the initializer (if any) and store it.
         if (stmt.HasInitExp())
@@ -272,11 +481,14 @@ class CodegenStmt : public StmtVisitor, CodegenBase
         GetBuilder()->CreateRet( result );
     }
 
-    // Generate code for a sequence of statements.
+    // Generate code for a sequence of statements.  Statements that follow a return statement (e.g.
+    // after the simplifier prunes "if (true) return x;") are unreachable, so no code is generated for them.
     void Visit( SeqStmt& seq ) override
     {
         for( const StmtPtr& stmt : seq.Get() )
         {
+            if( GetBuilder()->GetInsertBlock()->getTerminator() )
+                break;
             Codegen( *stmt );
         }
     }
@@ -284,16 +496,13 @@ class CodegenStmt : public StmtVisitor, CodegenBase
     // Generate code for an "if" statement.
     void Visit( IfStmt& stmt ) override
     {
-        // Generate code for the conditional expression.
-        Value* condition = codegenCondExp( stmt.GetCondExp() );
-
         // Create basic blocks for "then" branch, "else" branch (if any), and the join point.
         BasicBlock* thenBlock = BasicBlock::Create( *GetContext(), "then", m_currentFunction );
         BasicBlock* elseBlock = stmt.HasElseStmt() ? BasicBlock::Create( *GetContext(), "else", m_currentFunction ) : nullptr;
         BasicBlock* joinBlock = BasicBlock::Create( *GetContext(), "join", m_currentFunction );
 
-        // Create a conditional branch.
-        GetBuilder()->CreateCondBr( condition, thenBlock, elseBlock ? elseBlock : joinBlock );
+        // Generate a conditional branch on the conditional expression.
+        m_codegenCond.Codegen( stmt.GetCondExp(), thenBlock, elseBlock ? elseBlock : joinBlock );
 
         // Generate code for "then" branch
         GetBuilder()->SetInsertPoint( thenBlock );
@@ -328,20 +537,19 @@ class CodegenStmt : public StmtVisitor, CodegenBase
         GetBuilder()->CreateBr( loopBlock );
         GetBuilder()->SetInsertPoint( loopBlock );
 
-        // Generate code for the loop condition.
-        Value* condition = codegenCondExp( stmt.GetCondExp() );
-
         // Create basic blocks for the loop body and the join point.
         BasicBlock* bodyBlock = BasicBlock::Create( *GetContext(), "body", m_currentFunction );
         BasicBlock* joinBlock = BasicBlock::Create( *GetContext(), "join", m_currentFunction );
 
-        // Create a conditional branch.
-        GetBuilder()->CreateCondBr( condition, bodyBlock, joinBlock );
+        // Generate a conditional branch on the loop condition.
+        m_codegenCond.Codegen( stmt.GetCondExp(), bodyBlock, joinBlock );
 
-        // Generate code for the loop body, followed by an unconditional branch to the loop head.
+        // Generate code for the loop body, followed by an unconditional branch to the loop head
+        // (unless the body ends in a return instruction).
         GetBuilder()->SetInsertPoint( bodyBlock );
         Codegen( stmt.GetBodyStmt() );
-        GetBuilder()->CreateBr( loopBlock );
+        if( !GetBuilder()->GetInsertBlock()->getTerminator() )
+            GetBuilder()->CreateBr( loopBlock );
 
         // Set the builder insertion point in the join block.
         GetBuilder()->SetInsertPoint( joinBlock );
@@ -352,18 +560,7 @@ class CodegenStmt : public StmtVisitor, CodegenBase
     FunctionTable* m_functions;
     Function*      m_currentFunction;
     CodegenExp     m_codegenExp;
-
-    // Generate code for the condition expression in an "if" statement or a while loop.
-    Value* codegenCondExp( const Exp& exp )
-    {
-        Value* condition = m_codegenExp.Codegen( exp );
-        if ( exp.GetType() == kTypeBool )
-            return condition;
-
-        // Convert the integer conditional expresison to a boolean (i1) using a comparison.
-        assert( exp.GetType() == kTypeInt );
-        return GetBuilder()->CreateICmpNE( condition, GetInt( 0 ) );
-    }
+    CodegenCond    m_codegenCond;
 };
 
 
@@ -378,40 +575,35 @@ class CodegenFunc : public CodegenBase
     {
     }
 
-    // Generate code for a function definition.
-    void Codegen( const FuncDef* funcDef )
+    // Declare the LLVM function for a function definition, adding it to the function table.  Functions
+    // are declared before any code is generated, so calls can refer to functions that are defined later.
+    void Declare( const FuncDef* funcDef, bool partitioned )
     {
-        // Don't generate code for builtin function declarations.
-        if( !funcDef->HasBody() )
-            return;
-
-        // Convert parameter types to LLVM types.
-        const std::vector<VarDeclPtr>& params = funcDef->GetParams();
-        std::vector<llvm::Type*> paramTypes;
-        paramTypes.reserve( params.size() );
-        for( const VarDeclPtr& param : params )
-        {
-            paramTypes.push_back( ConvertType( param->GetType() ) );
-        }
-
-        // Construct LLVM function type and function definition.
-        llvm::Type*   returnType = ConvertType( funcDef->GetReturnType() );
-        FunctionType* funcType   = FunctionType::get( returnType, paramTypes, false /*isVarArg*/ );
-        Function* function = Function::Create( funcType, Function::ExternalLinkage, funcDef->GetName(), GetModule() );
-
-        // The main function has external linkage.  Other functions are
-        // "internal", which encourages inlining.
-        function->setLinkage( funcDef->GetName() == "main" ? Function::ExternalLinkage : Function::InternalLinkage );
-
-        // Update the function table.
-        m_functions->insert( FunctionTable::value_type( funcDef, function ) );
+        // The main function has external linkage.  Other functions are "internal", which encourages
+        // inlining, unless the program is partitioned, in which case they might be called from other
+        // modules.
+        std::string name = m_functions->GetName( funcDef );
+        bool        isExternal = partitioned || name == "main";
+        Function*   function =
+            DeclareFunction( funcDef, name, isExternal ? Function::ExternalLinkage : Function::InternalLinkage );
+        m_functions->Insert( funcDef, function );
+    }
 
-        // Construct a symbol table that maps the parameter declarations to the LLVM function parameters.
-        SymbolTable symbols;
+    // Generate code for a function definition, which must have been declared.
+    void Codegen( const FuncDef* funcDef )
+    {
+        Function* function = m_functions->Find( funcDef );
+        assert( function && funcDef->HasBody() );
+
+        // Reset the symbol table, which has a slot for each variable, and map the parameters (which
+        // occupy the first slots) to the LLVM function parameters.  The table is reused for each
+        // function, so it is reallocated only when it grows.
+        const ArenaArray<VarDeclPtr>& params = funcDef->GetParams();
+        m_symbols.assign( funcDef->GetNumSlots(), nullptr );
         size_t i = 0;
         for( Argument& arg : function->args() )
         {
-            symbols.insert( SymbolTable::value_type( params[i].get(), &arg ) );
+            m_symbols[params[i]->GetSlot()] = &arg;
             ++i;
         }
 
@@ -420,7 +612,7 @@ class CodegenFunc : public CodegenBase
         GetBuilder()->SetInsertPoint(block);
 
         // Generate code for the body of the function.
-        CodegenStmt codegen( GetContext(), GetModule(), GetBuilder(), &symbols, m_functions, function );
+        CodegenStmt codegen( GetContext(), GetModule(), GetBuilder(), &m_symbols, m_functions, function );
         codegen.Codegen( funcDef->GetBody() );
 
         // Add a return instruction if the user neglected to do so.
@@ -431,6 +623,7 @@ class CodegenFunc : public CodegenBase
   private:
     IRBuilder<> m_builder;
     FunctionTable* m_functions;
+    SymbolTable m_symbols;
 };
 
 } // anonymous namespace
@@ -439,16 +632,84 @@ class CodegenFunc : public CodegenBase
 // Generate code for a program.
 std::unique_ptr<Module> Codegen(LLVMContext* context, const Program& program)
 {
+    return Codegen( context, program, 0, 1 );
+}
+
+// Generate code for one partition of a program.
+std::unique_ptr<Module> Codegen( LLVMContext* context, const Program& program, int partition, int numPartitions )
+{
+    assert( 0 <= partition && partition < numPartitions );
+
     // Construct LLVM module.
     std::unique_ptr<Module> module( new Module( "module", *context ) );
 
     // The function table maps function definitions to their LLVM equivalents.
-    FunctionTable functions;
+    bool          partitioned = numPartitions > 1;
+    FunctionTable functions( program, partitioned );
 
-    // Generate code for each function, adding LLVM functions to the odule.
+    // Builtin function declarations have no code.  The remaining definitions are divided into
+    // contiguous ranges, since nearby functions are more likely to call each other.
+    std::vector<const FuncDef*> definitions;
     for( const FuncDefPtr& funcDef : program.GetFunctions() )
     {
-        CodegenFunc( context, module.get(), &functions ).Codegen( funcDef.get() );
+        if( funcDef->HasBody() )
+            definitions.push_back( funcDef );
     }
+    size_t begin = definitions.size() * partition / numPartitions;
+    size_t end   = definitions.size() * ( partition + 1 ) / numPartitions;
+
+    // Declare the functions in this partition, then generate code for each of them.
+    CodegenFunc codegen( context, module.get(), &functions );
+    for( size_t i = begin; i < end; ++i )
+        codegen.Declare( definitions[i], partitioned );
+    for( size_t i = begin; i < end; ++i )
+        codegen.Codegen( definitions[i] );
     return module;
 }
+
+// Generate a batch entry point that applies main to an array of inputs.
+bool CodegenBatchEntry( Module* module )
+{
+    LLVMContext& context = module->getContext();
+    IntegerType* intType = IntegerType::get( context, 32 );
+    Function*    mainFunc = module->getFunction( "main" );
+    FunctionType* mainType = FunctionType::get( intType, { intType }, false /*isVarArg*/ );
+    if( !mainFunc || mainFunc->isDeclaration() || mainFunc->getFunctionType() != mainType )
+        return false;
+
+    // void main_batch(const int* in, int* out, int n).  The arrays are noalias, so the vectorizer
+    // need not check for overlap at runtime.
+    PointerType*  ptrType = PointerType::get( context, 0 );
+    FunctionType* funcType =
+        FunctionType::get( llvm::Type::getVoidTy( context ), { ptrType, ptrType, intType }, false /*isVarArg*/ );
+    Function*     function = Function::Create( funcType, Function::ExternalLinkage, "main_batch", module );
+    Argument*     in = function->getArg( 0 );
+    Argument*     out = function->getArg( 1 );
+    Argument*     n = function->getArg( 2 );
+    in->addAttr( Attribute::NoAlias );
+    in->addAttr( Attribute::ReadOnly );
+    out->addAttr( Attribute::NoAlias );
+
+    // for( int i = 0; i < n; ++i ) out[i] = main( in[i] );
+    BasicBlock* entryBlock = BasicBlock::Create( context, "entry", function );
+    BasicBlock* loopBlock = BasicBlock::Create( context, "loop", function );
+    BasicBlock* exitBlock = BasicBlock::Create( context, "exit", function );
+    IRBuilder<> builder( entryBlock );
+    builder.CreateCondBr( builder.CreateICmpSGT( n, builder.getInt32( 0 ) ), loopBlock, exitBlock );
+
+    builder.SetInsertPoint( loopBlock );
+    PHINode*  i = builder.CreatePHI( intType, 2, "i" );
+    Value*    index = builder.CreateZExt( i, builder.getInt64Ty() );
+    Value*    input = builder.CreateLoad( intType, builder.CreateInBoundsGEP( intType, in, index ) );
+    CallInst* result = builder.CreateCall( mainFunc, { input } );
+    result->addFnAttr( Attribute::AlwaysInline );
+    builder.CreateStore( result, builder.CreateInBoundsGEP( intType, out, index ) );
+    Value* next = builder.CreateAdd( i, builder.getInt32( 1 ), "next", true /*hasNUW*/, true /*hasNSW*/ );
+    builder.CreateCondBr( builder.CreateICmpEQ( next, n ), exitBlock, loopBlock );
+    i->addIncoming( builder.getInt32( 0 ), entryBlock );
+    i->addIncoming( next, loopBlock );
+
+    builder.SetInsertPoint( exitBlock );
+    builder.CreateRetVoid();
+    return true;
+}
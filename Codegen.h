@@ -7,3 +7,16 @@ namespace llvm { class LLVMContext; class Module; }
 
 // Generate LLVM IR for the given program.
 std::unique_ptr<llvm::Module> Codegen( llvm::LLVMContext* context, const Program& program );
+
+// Generate LLVM IR for one partition of the given program.  The function definitions are divided into
+// numPartitions contiguous ranges, each of which is compiled into a separate module, declaring any
+// functions that it calls from other partitions.  Partitions can be generated concurrently, provided
+// each one uses its own LLVM context.
+std::unique_ptr<llvm::Module> Codegen( llvm::LLVMContext* context, const Program& program, int partition,
+                                       int numPartitions );
+
+// Generate a batch entry point, main_batch(const int* in, int* out, int n), that applies main to each of
+// n inputs.  The call to main is marked always-inline, which allows the loop vectorizer to process several
+// inputs at once when main is simple enough.  The input and output arrays must not overlap.  Returns false
+// if the module does not define main with the expected signature (int -> int).
+bool CodegenBatchEntry( llvm::Module* module );
@@ -0,0 +1,138 @@
+#include "CompileStats.h"
+
+#include <llvm/Support/Format.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+
+namespace {
+
+// llvm::format requires scalar arguments, so string literals (which are arrays) are passed as pointers.
+using CStr = const char*;
+
+// Add a value to the named entry of a vector of (name, value) pairs, which remains in insertion order.
+template<typename T>
+void accumulate( std::vector<std::pair<std::string, T>>* entries, const std::string& name, const T& value )
+{
+    for( std::pair<std::string, T>& entry : *entries )
+    {
+        if( entry.first == name )
+        {
+            entry.second += value;
+            return;
+        }
+    }
+    entries->emplace_back( name, value );
+}
+
+// Get the pass times sorted by decreasing time.
+std::vector<std::pair<std::string, double>> sortPassTimes( const std::map<std::string, double>& passTimes )
+{
+    std::vector<std::pair<std::string, double>> sorted( passTimes.begin(), passTimes.end() );
+    std::stable_sort( sorted.begin(), sorted.end(),
+                      []( const std::pair<std::string, double>& a, const std::pair<std::string, double>& b ) {
+                          return a.second > b.second;
+                      } );
+    return sorted;
+}
+
+}  // anonymous namespace
+
+void CompileStats::AddPhase( const std::string& phase, const llvm::TimeRecord& time )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    accumulate( &m_phases, phase, time );
+}
+
+void CompileStats::AddCounter( const std::string& counter, uint64_t value )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    accumulate( &m_counters, counter, value );
+}
+
+void CompileStats::AddPassTime( const std::string& pass, double seconds )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_passTimes[pass] += seconds;
+}
+
+double CompileStats::GetWallTime( const std::string& phase ) const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    for( const std::pair<std::string, llvm::TimeRecord>& entry : m_phases )
+    {
+        if( entry.first == phase )
+            return entry.second.getWallTime();
+    }
+    return 0;
+}
+
+uint64_t CompileStats::GetCounter( const std::string& counter ) const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    for( const std::pair<std::string, uint64_t>& entry : m_counters )
+    {
+        if( entry.first == counter )
+            return entry.second;
+    }
+    return 0;
+}
+
+void CompileStats::PrintTable( llvm::raw_ostream& out ) const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    // Phase times, in milliseconds.
+    llvm::TimeRecord total;
+    out << llvm::format( "%-24s %12s %12s %12s\n", CStr( "Phase" ), CStr( "Wall (ms)" ), CStr( "User (ms)" ),
+                         CStr( "System (ms)" ) );
+    for( const std::pair<std::string, llvm::TimeRecord>& phase : m_phases )
+    {
+        const llvm::TimeRecord& time = phase.second;
+        out << llvm::format( "%-24s %12.3f %12.3f %12.3f\n", phase.first.c_str(), time.getWallTime() * 1000,
+                             time.getUserTime() * 1000, time.getSystemTime() * 1000 );
+        total += time;
+    }
+    out << llvm::format( "%-24s %12.3f %12.3f %12.3f\n", CStr( "total" ), total.getWallTime() * 1000,
+                         total.getUserTime() * 1000, total.getSystemTime() * 1000 );
+
+    out << "\n" << llvm::format( "%-24s %12s\n", CStr( "Counter" ), CStr( "Value" ) );
+    for( const std::pair<std::string, uint64_t>& counter : m_counters )
+        out << llvm::format( "%-24s %12llu\n", counter.first.c_str(), (unsigned long long) counter.second );
+
+    if( !m_passTimes.empty() )
+    {
+        out << "\n" << llvm::format( "%-48s %12s\n", CStr( "Optimization pass" ), CStr( "Wall (ms)" ) );
+        for( const std::pair<std::string, double>& pass : sortPassTimes( m_passTimes ) )
+            out << llvm::format( "%-48s %12.3f\n", pass.first.c_str(), pass.second * 1000 );
+    }
+}
+
+// The JSON object has "phases", "counters" and "passes" members.  Times are in seconds.
+void CompileStats::PrintJSON( llvm::raw_ostream& out ) const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    llvm::json::OStream json( out, 2 /*indent*/ );
+    json.object( [&] {
+        json.attributeObject( "phases", [&] {
+            for( const std::pair<std::string, llvm::TimeRecord>& phase : m_phases )
+            {
+                json.attributeObject( phase.first, [&] {
+                    json.attribute( "wall", phase.second.getWallTime() );
+                    json.attribute( "user", phase.second.getUserTime() );
+                    json.attribute( "system", phase.second.getSystemTime() );
+                } );
+            }
+        } );
+        json.attributeObject( "counters", [&] {
+            for( const std::pair<std::string, uint64_t>& counter : m_counters )
+                json.attribute( counter.first, static_cast<int64_t>( counter.second ) );
+        } );
+        json.attributeObject( "passes", [&] {
+            for( const std::pair<std::string, double>& pass : sortPassTimes( m_passTimes ) )
+                json.attribute( pass.first, pass.second );
+        } );
+    } );
+    out << "\n";
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <llvm/Support/Timer.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+/// Statistics gathered while compiling a program: the wall-clock and CPU time of each phase
+/// (lex, parse, typecheck, codegen, optimize, jit), counters such as the number of tokens, syntax
+/// nodes and IR instructions, and the time spent in each LLVM optimization pass.
+///
+/// Statistics can be added concurrently.  When code is generated in several partitions (\see
+/// Codegen), the times of the concurrent phases are summed over the partitions, and their CPU
+/// times include work done on other threads.
+class CompileStats
+{
+  public:
+    /// Add the given time to the named phase.  Phases are reported in the order they were first added.
+    void AddPhase( const std::string& phase, const llvm::TimeRecord& time );
+
+    /// Add the given value to the named counter.  Counters are reported in the order they were first added.
+    void AddCounter( const std::string& counter, uint64_t value );
+
+    /// Add the given (wall-clock) time, in seconds, to the named optimization pass.
+    void AddPassTime( const std::string& pass, double seconds );
+
+    /// Get the wall-clock time of the named phase, in seconds, which is zero if it has not been added.
+    double GetWallTime( const std::string& phase ) const;
+
+    /// Get the value of the named counter, which is zero if it has not been added.
+    uint64_t GetCounter( const std::string& counter ) const;
+
+    /// Print the statistics as a table, for -ftime-report.
+    void PrintTable( llvm::raw_ostream& out ) const;
+
+    /// Print the statistics as a JSON object, for --stats=<file>.
+    void PrintJSON( llvm::raw_ostream& out ) const;
+
+  private:
+    mutable std::mutex                                    m_mutex;
+    std::vector<std::pair<std::string, llvm::TimeRecord>> m_phases;
+    std::vector<std::pair<std::string, uint64_t>>         m_counters;
+    std::map<std::string, double>                         m_passTimes;
+};
+
+
+/// Measures the time between its construction and destruction, adding it to the named phase
+/// of the given statistics, which may be null (in which case nothing is measured).
+class PhaseTimer
+{
+  public:
+    PhaseTimer( CompileStats* stats, const char* phase )
+        : m_stats( stats )
+        , m_phase( phase )
+    {
+        if( m_stats )
+            m_start = llvm::TimeRecord::getCurrentTime( true /*start*/ );
+    }
+
+    ~PhaseTimer()
+    {
+        if( !m_stats )
+            return;
+        llvm::TimeRecord time = llvm::TimeRecord::getCurrentTime( false /*start*/ );
+        time -= m_start;
+        m_stats->AddPhase( m_phase, time );
+    }
+
+    PhaseTimer( const PhaseTimer& )            = delete;
+    PhaseTimer& operator=( const PhaseTimer& ) = delete;
+
+  private:
+    CompileStats*    m_stats;
+    const char*      m_phase;
+    llvm::TimeRecord m_start;
+};
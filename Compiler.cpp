@@ -0,0 +1,440 @@
+#include "Compiler.h"
+#include "Builtins.h"
+#include "Codegen.h"
+#include "CompileStats.h"
+#include "CompilerSession.h"
+#include "DiskObjectCache.h"
+#include "FuncDef.h"
+#include "Parser.h"
+#include "Printer.h"
+#include "Program.h"
+#include "SimpleJIT.h"
+#include "Simplifier.h"
+#include "TieredJIT.h"
+#include "TokenBuffer.h"
+#include "TokenStream.h"
+#include "Typechecker.h"
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/raw_os_ostream.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/TargetParser/Host.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+
+namespace {
+
+// Parse the given token stream, adding definitions to the given Program.  Lexing is included in
+// the parse phase, unless the tokens were lexed in advance.
+int parse( TokenStream& tokens, Program* program, size_t* numTokens, CompileStats* stats )
+{
+    PhaseTimer timer( stats, "parse" );
+    int        status = ParseProgram( tokens, program );
+    *numTokens        = tokens.GetNumTokens();
+    return status;
+}
+
+// Record the size of the given program, and typecheck it on the given number of threads if it was
+// parsed successfully (as indicated by the given status).  Calls are resolved against the builtin
+// declarations as well as the user's definitions.
+int typecheck( int parseStatus, size_t numTokens, Program* program, int numThreads, CompileStats* stats )
+{
+    if( stats )
+    {
+        stats->AddCounter( "tokens", numTokens );
+        stats->AddCounter( "functions", program->GetFunctions().size() );
+        stats->AddCounter( "syntax nodes", program->GetArena().GetNumObjects() );
+    }
+
+    int status = parseStatus;
+    if( status == 0 )
+    {
+        PhaseTimer timer( stats, "typecheck" );
+        status = Typecheck( *program, GetBuiltinIndex(), numThreads );
+    }
+    return status;
+}
+
+// Simplify the given (typechecked) program before code generation, unless simplification is disabled.
+// The number of replaced syntax nodes is recorded.
+void simplify( Program* program, bool enabled, CompileStats* stats )
+{
+    if( !enabled )
+        return;
+    PhaseTimer timer( stats, "simplify" );
+    int        numSimplified = Simplify( *program );
+    if( stats )
+        stats->AddCounter( "simplified nodes", numSimplified );
+}
+
+// Describe the target machine specified by the compiler options.  The same description is used
+// by the optimizer and the JIT, so the pass pipeline sees the same CPU features as the code generator.
+// By default the host CPU and its features are detected; -mcpu=generic selects a generic CPU of the
+// host architecture, so that the generated code (and any cached objects) do not depend on the host.
+JITTargetMachineBuilder getTarget( const CompilerOptions& options )
+{
+    JITTargetMachineBuilder target( llvm::Triple( llvm::sys::getProcessTriple() ) );
+    if( options.cpu.empty() || options.cpu == "native" )
+        target = llvm::cantFail( JITTargetMachineBuilder::detectHost() );
+    else
+        target.setCPU( options.cpu );
+
+    llvm::SmallVector<llvm::StringRef, 8> features;
+    llvm::StringRef( options.features ).split( features, ',', -1 /*maxSplit*/, false /*keepEmpty*/ );
+    for( llvm::StringRef feature : features )
+        target.getFeatures().AddFeature( feature );
+    return target;
+}
+
+// Get a string that identifies the given target machine, for use in cache keys.
+std::string describeTarget( const JITTargetMachineBuilder& target )
+{
+    return target.getTargetTriple().str() + " " + target.getCPU() + " " + target.getFeatures().getString();
+}
+
+// Get the cache key of one partition of a program.  \see Compiler::codegen
+std::string partitionKey( const std::string& cacheKey, int partition, int numPartitions )
+{
+    if( numPartitions == 1 )
+        return cacheKey;
+    return cacheKey + "." + std::to_string( partition ) + "-of-" + std::to_string( numPartitions );
+}
+
+// Load the cached objects for every partition of a program, returning an empty vector unless all
+// of them are cached.
+std::vector<std::unique_ptr<llvm::MemoryBuffer>> loadCachedObjects( const DiskObjectCache& objectCache,
+                                                                    const std::string& cacheKey,
+                                                                    int numPartitions )
+{
+    std::vector<std::unique_ptr<llvm::MemoryBuffer>> objects;
+    for( int partition = 0; partition < numPartitions; ++partition )
+    {
+        std::unique_ptr<llvm::MemoryBuffer> object =
+            objectCache.Load( partitionKey( cacheKey, partition, numPartitions ) );
+        if( !object )
+            return {};
+        objects.push_back( std::move( object ) );
+    }
+    return objects;
+}
+
+// Dump syntax for debugging if the "ENABLE_DUMP" environment variable is set.  The syntax is dumped
+// after typechecking and before it is simplified, so it matches the source.
+void dumpSyntax( const Program& program, const char* srcFilename )
+{
+    if ( !getenv("ENABLE_DUMP") )
+        return;
+    std::string   filename( std::string( srcFilename ) + ".syn" );
+    std::ofstream out( filename );
+    out << program << std::endl;
+
+    // Report the memory used by the syntax tree.
+    const Arena& arena = program.GetArena();
+    out << "// " << arena.GetNumObjects() << " syntax nodes, " << arena.GetBytesUsed() << " bytes used, "
+        << arena.GetBytesReserved() << " bytes reserved" << std::endl;
+}
+
+// Dump LLVM IR for debugging if the "ENABLE_DUMP" environment variable is set.
+void dumpIR( llvm::Module& module, const char* srcFilename, const std::string& what )
+{
+    if ( !getenv("ENABLE_DUMP") )
+        return;
+    std::string   filename( std::string( srcFilename ) + "." + what + ".ll" );
+    std::ofstream stream( filename );
+    llvm::raw_os_ostream out( stream );
+    out << module;
+}
+
+} // anonymous namespace
+
+
+CompiledProgram::CompiledProgram()
+    : m_hasBatchEntry( false )
+{
+}
+
+CompiledProgram::~CompiledProgram() = default;
+
+void* CompiledProgram::FindFunction( const std::string& name )
+{
+    PhaseTimer timer( m_stats.get(), "jit" );
+    auto symbolResult = m_tieredJit ? m_tieredJit->findSymbol( name ) : m_jit->findSymbol( name );
+    if( !symbolResult )
+    {
+        llvm::consumeError( symbolResult.takeError() );
+        return nullptr;
+    }
+    return reinterpret_cast<void*>( symbolResult->getValue() );
+}
+
+BatchFunc CompiledProgram::GetMainBatch()
+{
+    return m_hasBatchEntry ? GetFunction<void( const int*, int*, int )>( "main_batch" ) : nullptr;
+}
+
+
+Compiler::Compiler( const CompilerOptions& options )
+    : m_options( options )
+    , m_target( getTarget( options ) )
+{
+    SimpleJIT::initializeLLVM();
+}
+
+Compiler::~Compiler() = default;
+
+// The call to main can be inlined into main_batch only if main_batch is optimized in the same module,
+// so lazy and tiered JITs, which compile functions individually, do not generate it.
+bool Compiler::useBatchEntry() const
+{
+    return m_options.batchEntry && !m_options.lazy && !m_options.tiered;
+}
+
+// The lazy and tiered JITs are given compiler sessions of their own, since they optimize after
+// Compile returns: the lazy JIT on the threads that call the program, and the tiered JIT on a
+// background thread.
+std::unique_ptr<CompiledProgram> Compiler::createProgram( bool useCache )
+{
+    std::unique_ptr<CompiledProgram> result( new CompiledProgram );
+    result->m_hasBatchEntry = useBatchEntry();
+    if( m_options.collectStats )
+        result->m_stats.reset( new CompileStats );
+
+    // Construct JIT engine, using the object cache (if any).  Lazy and tiered JITs compile
+    // individual functions, so they do not use the object cache.
+    const CompilerOptions& options = m_options;
+    if( useCache && !options.cacheDir.empty() && !options.lazy && !options.tiered )
+        result->m_objectCache.reset( new DiskObjectCache( options.cacheDir ) );
+    result->m_jit.reset( new SimpleJIT( m_target, result->m_objectCache.get(), options.lazy && !options.tiered ) );
+    SimpleJIT& jit = *result->m_jit;
+
+    // A lazy JIT optimizes each function when it is first called, on the calling thread, so
+    // functions called from several threads are optimized concurrently.  A compiler session is not
+    // thread-safe, so it is locked while it optimizes.
+    if( jit.isLazy() )
+    {
+        std::shared_ptr<CompilerSession> session( new CompilerSession( m_target ) );
+        std::shared_ptr<std::mutex>      mutex( new std::mutex );
+        int                              optLevel = options.optLevel;
+        jit.setOptimizer( [session, mutex, optLevel]( llvm::Module& module ) {
+            std::lock_guard<std::mutex> lock( *mutex );
+            session->Optimize( &module, optLevel );
+        } );
+    }
+
+    // In tiered mode, everything is first compiled at -O0, and hot functions are recompiled at
+    // -O3 in the background, using a compiler session of their own.
+    if( options.tiered )
+    {
+        std::shared_ptr<CompilerSession> session( new CompilerSession( m_target ) );
+        result->m_tieredJit.reset(
+            new TieredJIT( jit, [session]( llvm::Module& module ) { session->Optimize( &module, 3 ); } ) );
+    }
+    return result;
+}
+
+std::unique_ptr<CompiledProgram> Compiler::Compile( const char* source, const char* name )
+{
+    std::unique_ptr<CompiledProgram> result = createProgram( true /*useCache*/ );
+    CompileStats* stats = result->m_stats.get();
+
+    // If the object code for this source is already cached, skip straight to the JIT.  Otherwise
+    // compile the source, naming the modules with the cache key so the JIT will cache the objects.
+    // Objects that define main_batch, or were generated without simplifying the program, are cached
+    // separately from the others.
+    std::string cacheKey;
+    if( result->m_objectCache )
+    {
+        std::string targetDesc = describeTarget( m_target ) + ( useBatchEntry() ? " main_batch" : "" ) +
+                                 ( m_options.simplify ? "" : " no-simplify" );
+        cacheKey = DiskObjectCache::ComputeKey( source, m_options.optLevel, targetDesc );
+        std::vector<std::unique_ptr<llvm::MemoryBuffer>> cachedObjects =
+            loadCachedObjects( *result->m_objectCache, cacheKey, m_options.numThreads );
+        if( !cachedObjects.empty() )
+        {
+            PhaseTimer timer( stats, "jit" );
+            if( stats )
+                stats->AddCounter( "cached objects", cachedObjects.size() );
+            for( std::unique_ptr<llvm::MemoryBuffer>& object : cachedObjects )
+            {
+                auto addResult = result->m_jit->addObjectFile( std::move( object ) );
+                if (addResult) {
+                    std::cerr << "Failed to add cached object to JIT: " << toString(std::move(addResult)) << std::endl;
+                    return nullptr;
+                }
+            }
+            return result;
+        }
+    }
+
+    // Parse user source code.  With several threads, each one lexes and parses a range of function
+    // definitions (so lexing is included in the parse phase).  Otherwise the entire source is lexed
+    // in advance, unless the parser is to call the lexer on demand.
+    ProgramPtr program( new Program );
+    size_t     numTokens;
+    int        status;
+    if( m_options.preLex && m_options.numThreads > 1 )
+    {
+        PhaseTimer timer( stats, "parse" );
+        status = ParseProgram( source, program.get(), m_options.numThreads, &numTokens );
+    }
+    else
+    {
+        std::unique_ptr<TokenBuffer> tokenBuffer;
+        if( m_options.preLex )
+        {
+            PhaseTimer timer( stats, "lex" );
+            tokenBuffer.reset( new TokenBuffer( source ) );
+        }
+
+        // The token stream encapsulates the lexer.  \see TokenStream.
+        TokenStream tokens = tokenBuffer ? TokenStream( tokenBuffer.get() ) : TokenStream( source );
+        status = parse( tokens, program.get(), &numTokens, stats );
+    }
+    if( typecheck( status, numTokens, program.get(), m_options.numThreads, stats ) )
+        return nullptr;
+    dumpSyntax( *program, name );
+    simplify( program.get(), m_options.simplify, stats );
+
+    if( codegen( *program, name, cacheKey, result.get() ) )
+        return nullptr;
+    return result;
+}
+
+// The source is lexed as it is read, so its object code is not cached: the cache key is a hash of
+// the entire source, which is not available until the source has been parsed.
+std::unique_ptr<CompiledProgram> Compiler::Compile( std::FILE* file, const char* name )
+{
+    std::unique_ptr<CompiledProgram> result = createProgram( false /*useCache*/ );
+    CompileStats* stats = result->m_stats.get();
+
+    // Parse and typecheck user source code, reading it as the lexer requests it.
+    LexerInput  input( file );
+    TokenStream tokens( &input );
+    ProgramPtr  program( new Program );
+    size_t      numTokens;
+    int         status = parse( tokens, program.get(), &numTokens, stats );
+    if( input.HasError() )
+    {
+        std::cerr << "Unable to read source from " << name << std::endl;
+        return nullptr;
+    }
+    if( typecheck( status, numTokens, program.get(), m_options.numThreads, stats ) )
+        return nullptr;
+    dumpSyntax( *program, name );
+    simplify( program.get(), m_options.simplify, stats );
+
+    if( codegen( *program, name, "" /*cacheKey*/, result.get() ) )
+        return nullptr;
+    return result;
+}
+
+// Generate code for the given program and add it to the JIT engine.  The program is divided into
+// one partition per thread, each of which is generated and optimized concurrently in its own module,
+// using its own compiler session.
+// The modules are named with the given cache key (if any), which allows the JIT to cache the
+// resulting object code.  If a tiered JIT is used, the modules are added to it rather than
+// directly to the JIT engine.
+int Compiler::codegen( const Program& program, const char* name, const std::string& cacheKey,
+                       CompiledProgram* result )
+{
+    SimpleJIT&    jit        = *result->m_jit;
+    TieredJIT*    tieredJit  = result->m_tieredJit.get();
+    CompileStats* stats      = result->m_stats.get();
+    bool          batchEntry = useBatchEntry();
+    int           optLevel   = tieredJit ? 0 : m_options.optLevel;  // the tiered JIT recompiles hot code
+
+    // Construct a compiler session for each thread, which owns the target machine and pass
+    // pipelines used by the optimizer.  The sessions are reused by subsequent compilations.
+    int numPartitions = m_options.numThreads;
+    if( !jit.isLazy() )
+    {
+        while( m_sessions.size() < static_cast<size_t>( numPartitions ) )
+            m_sessions.emplace_back( new CompilerSession( m_target ) );
+        for( std::unique_ptr<CompilerSession>& session : m_sessions )
+            session->SetStats( stats );
+    }
+
+    // Generate and optimize LLVM IR for one partition, using a separate context for each one.
+    std::vector<ThreadSafeModule> modules( numPartitions );
+    auto codegenPartition = [&]( int partition ) {
+        std::string suffix = numPartitions == 1 ? "" : "." + std::to_string( partition );
+        auto context = std::make_unique<llvm::LLVMContext>();
+        std::unique_ptr<llvm::Module> module;
+        {
+            PhaseTimer timer( stats, "codegen" );
+            module = Codegen( context.get(), program, partition, numPartitions );
+
+            // In batch mode, the partition that defines main also defines main_batch.
+            if( batchEntry )
+                CodegenBatchEntry( module.get() );
+        }
+        if( !cacheKey.empty() )
+            module->setModuleIdentifier( partitionKey( cacheKey, partition, numPartitions ) );
+        if( stats )
+            stats->AddCounter( "IR instructions", module->getInstructionCount() );
+        dumpIR( *module, name, "initial" + suffix );
+
+        // Verify the module, which catches malformed instructions and type errors.
+        assert(!verifyModule(*module, &llvm::errs()));
+
+        // Optimize the module, unless the JIT is lazy, in which case it optimizes each function
+        // on demand.
+        if( !jit.isLazy() )
+        {
+            {
+                PhaseTimer timer( stats, "optimize" );
+                m_sessions[partition]->Optimize( module.get(), optLevel );
+            }
+            if( stats )
+                stats->AddCounter( "optimized IR instructions", module->getInstructionCount() );
+            dumpIR( *module, name, "optimized" + suffix );
+        }
+        modules[partition] = ThreadSafeModule( std::move( module ), std::move( context ) );
+    };
+    if( numPartitions == 1 )
+        codegenPartition( 0 );
+    else
+    {
+        llvm::DefaultThreadPool pool( llvm::hardware_concurrency( numPartitions ) );
+        for( int partition = 0; partition < numPartitions; ++partition )
+            pool.async( codegenPartition, partition );
+        pool.wait();
+    }
+    for( std::unique_ptr<CompilerSession>& session : m_sessions )
+        session->SetStats( nullptr );
+
+    // Add the modules to the JIT engine, which generates native code when their functions are looked up.
+    PhaseTimer timer( stats, "jit" );
+    for( ThreadSafeModule& module : modules )
+    {
+        auto addResult = tieredJit ? tieredJit->addModule( std::move(module) ) : jit.addModule( std::move(module) );
+        if (addResult) {
+            std::cerr << "Failed to add module to JIT: " << toString(std::move(addResult)) << std::endl;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+
+// Load file into a null-terminated buffer.  Returns zero for success.
+int ReadSourceFile( const char* filename, std::unique_ptr<llvm::MemoryBuffer>* buffer )
+{
+    // The MemoryBuffer maps the file (unless it is small), in which case the null terminator comes
+    // for free: the tail of the last page, past the end of the file, is zero-filled.  When the file
+    // size is an exact multiple of the page size there is no such tail, so the file is read into a
+    // heap buffer instead.  The file must not be modified while it is mapped.
+    auto result = llvm::MemoryBuffer::getFile( filename, false /*isText*/, true /*requiresNullTerminator*/,
+                                               false /*isVolatile*/ );
+    if( !result )
+        return -1;
+    *buffer = std::move( *result );
+    return 0;
+}
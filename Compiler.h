@@ -0,0 +1,137 @@
+#pragma once
+
+#include "BatchIO.h"
+
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CompileStats;
+class CompilerSession;
+class DiskObjectCache;
+class Program;
+class SimpleJIT;
+class TieredJIT;
+
+namespace llvm {
+class MemoryBuffer;
+}
+
+/// Options that control how a Compiler compiles programs.
+struct CompilerOptions
+{
+    int         optLevel     = 2;      // optimization level (0 - 3)
+    int         numThreads   = 1;      // number of threads that parse, generate and optimize code
+    bool        lazy         = false;  // compile each function on demand, when it is first called
+    bool        tiered       = false;  // compile at -O0, then recompile hot functions at -O3
+    bool        batchEntry   = false;  // generate main_batch (ignored when lazy or tiered)  \see CodegenBatchEntry
+    bool        collectStats = false;  // record phase times and counters  \see CompiledProgram::GetStats
+    bool        preLex       = true;   // lex source strings entirely before parsing  \see TokenBuffer
+    bool        simplify     = true;   // fold constants and prune constant branches before codegen  \see Simplify
+    std::string cacheDir;              // directory of cached object code, if any (ignored when lazy or tiered)
+    std::string cpu;                   // target CPU, e.g. "generic" (default or "native" is the host CPU)
+    std::string features;              // comma-separated target features, e.g. "+avx2,-fma"
+};
+
+
+/// A compiled program, which holds the JIT engine that owns its code.  Functions in the program
+/// can be looked up once and called any number of times, until the program is destroyed.
+/// \see Compiler::Compile
+class CompiledProgram
+{
+  public:
+    ~CompiledProgram();
+
+    CompiledProgram( const CompiledProgram& )            = delete;
+    CompiledProgram& operator=( const CompiledProgram& ) = delete;
+
+    /// Get the address of the function with the given (JIT) name, or null if it is not defined.
+    /// The main function keeps its source name; other functions are renamed when the program is
+    /// compiled in several partitions.  \see Codegen
+    void* FindFunction( const std::string& name );
+
+    /// Get the function with the given name as a pointer to the given function type (e.g. int(int)),
+    /// or null if it is not defined.  The caller is responsible for specifying the right type.
+    template<typename FuncType>
+    FuncType* GetFunction( const std::string& name )
+    {
+        return reinterpret_cast<FuncType*>( FindFunction( name ) );
+    }
+
+    /// Get the main function, or null if it is not defined.
+    MainFunc GetMain() { return GetFunction<int( int )>( "main" ); }
+
+    /// Get the batch entry point, or null if it was not generated.  \see CompilerOptions::batchEntry
+    BatchFunc GetMainBatch();
+
+    /// Get the compilation statistics, or null unless they were requested.  \see CompilerOptions::collectStats
+    /// The time taken to look up functions is included in the "jit" phase, since the JIT generates code
+    /// when a function is first looked up.  Functions that a lazy or tiered JIT optimizes later are not
+    /// included.
+    const CompileStats* GetStats() const { return m_stats.get(); }
+
+  private:
+    friend class Compiler;
+
+    // Members are destroyed in reverse order: the tiered JIT (if any) before the JIT engine, which it
+    // uses, and the JIT engine before the object cache.
+    std::unique_ptr<CompileStats>    m_stats;
+    std::unique_ptr<DiskObjectCache> m_objectCache;
+    std::unique_ptr<SimpleJIT>       m_jit;
+    std::unique_ptr<TieredJIT>       m_tieredJit;
+    bool                             m_hasBatchEntry;
+
+    CompiledProgram();
+};
+
+
+/// A Compiler compiles source code into programs that can be called directly.  It owns the target
+/// description and compiler sessions (\see CompilerSession), which are reused for every program it
+/// compiles.  A compiler is not thread-safe, but the programs it produces can be called from any
+/// thread, and they outlive the compiler.
+class Compiler
+{
+  public:
+    /// Construct a compiler with the given options.  The LLVM native target is initialized if necessary.
+    explicit Compiler( const CompilerOptions& options );
+
+    ~Compiler();
+
+    Compiler( const Compiler& )            = delete;
+    Compiler& operator=( const Compiler& ) = delete;
+
+    /// Compile the given null-terminated source code.  The given name (typically the source filename)
+    /// is used to name debugging output.  Returns null if an error is reported.
+    std::unique_ptr<CompiledProgram> Compile( const char* source, const char* name = "<source>" );
+
+    /// Compile the source code read from the given file (e.g. a pipe), which is lexed as it is read, so
+    /// the source need not fit in memory.  The file is read to the end, but not closed.
+    /// The object cache is not used.  Returns null if an error is reported.
+    std::unique_ptr<CompiledProgram> Compile( std::FILE* file, const char* name );
+
+    /// Get the options given to the constructor.
+    const CompilerOptions& GetOptions() const { return m_options; }
+
+  private:
+    CompilerOptions                               m_options;
+    llvm::orc::JITTargetMachineBuilder            m_target;
+    std::vector<std::unique_ptr<CompilerSession>> m_sessions;  // one per thread, created on first use
+
+    // Returns true if a batch entry point should be generated.
+    bool useBatchEntry() const;
+
+    // Construct a program with an empty JIT engine, using the object cache (if any) if requested.
+    std::unique_ptr<CompiledProgram> createProgram( bool useCache );
+
+    // Generate and optimize code for the given program, adding it to the JIT engine.
+    int codegen( const Program& program, const char* name, const std::string& cacheKey, CompiledProgram* result );
+};
+
+
+/// Load the given file into a buffer that is null-terminated (for the benefit of the Lexer).  Large
+/// files are mapped read-only into memory rather than copied, and the lexer reads the mapped pages
+/// directly.  Returns zero for success.
+int ReadSourceFile( const char* filename, std::unique_ptr<llvm::MemoryBuffer>* buffer );
@@ -0,0 +1,100 @@
+#include "CompilerSession.h"
+#include "CompileStats.h"
+
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <optional>
+
+CompilerSession::CompilerSession( llvm::orc::JITTargetMachineBuilder target )
+{
+    // Create the target machine, which tells the optimizer what the CPU supports.
+    auto targetMachine = target.createTargetMachine();
+    if( targetMachine )
+        m_targetMachine = std::move( *targetMachine );
+    else
+        llvm::errs() << "Warning: Could not create target machine for optimization: "
+                     << llvm::toString( targetMachine.takeError() ) << "\n";
+
+    // Track the running passes, for pass timing.  The callbacks do nothing unless statistics are
+    // being recorded.
+    m_instrumentation.registerBeforeNonSkippedPassCallback( [this]( llvm::StringRef pass, llvm::Any ) {
+        if( !m_stats )
+            return;
+        chargeRunningPass();
+        m_runningPasses.push_back( pass.str() );
+    } );
+    m_instrumentation.registerAfterPassCallback(
+        [this]( llvm::StringRef, llvm::Any, const llvm::PreservedAnalyses& ) {
+            if( !m_stats || m_runningPasses.empty() )
+                return;
+            chargeRunningPass();
+            m_runningPasses.pop_back();
+        } );
+    m_instrumentation.registerAfterPassInvalidatedCallback( [this]( llvm::StringRef, const llvm::PreservedAnalyses& ) {
+        if( !m_stats || m_runningPasses.empty() )
+            return;
+        chargeRunningPass();
+        m_runningPasses.pop_back();
+    } );
+
+    // Register analyses with the analysis managers, in the same order as the LLVM opt tool.
+    m_passBuilder.reset(
+        new llvm::PassBuilder( m_targetMachine.get(), llvm::PipelineTuningOptions(), std::nullopt, &m_instrumentation ) );
+    m_passBuilder->registerModuleAnalyses( m_moduleAnalyses );
+    m_passBuilder->registerCGSCCAnalyses( m_cgsccAnalyses );
+    m_passBuilder->registerFunctionAnalyses( m_functionAnalyses );
+    m_passBuilder->registerLoopAnalyses( m_loopAnalyses );
+    m_passBuilder->crossRegisterProxies( m_loopAnalyses, m_functionAnalyses, m_cgsccAnalyses, m_moduleAnalyses );
+}
+
+void CompilerSession::Optimize( llvm::Module* module, int optLevel )
+{
+    if( m_targetMachine )
+    {
+        module->setDataLayout( m_targetMachine->createDataLayout() );
+        module->setTargetTriple( m_targetMachine->getTargetTriple().str() );
+    }
+
+    // Skip optimization for O0
+    if( optLevel <= 0 )
+        return;
+    if( optLevel > 3 )
+        optLevel = 3;
+
+    // Build the pipeline for this optimization level, if necessary.
+    std::unique_ptr<llvm::ModulePassManager>& pipeline = m_pipelines[optLevel];
+    if( !pipeline )
+    {
+        static const llvm::OptimizationLevel levels[] = { llvm::OptimizationLevel::O0, llvm::OptimizationLevel::O1,
+                                                          llvm::OptimizationLevel::O2, llvm::OptimizationLevel::O3 };
+        pipeline.reset( new llvm::ModulePassManager( m_passBuilder->buildPerModuleDefaultPipeline( levels[optLevel] ) ) );
+    }
+    m_lastPassEvent = Clock::now();
+    pipeline->run( *module, m_moduleAnalyses );
+
+    // Add the pass times to the statistics.
+    if( m_stats )
+    {
+        for( const auto& pass : m_passTimes )
+            m_stats->AddPassTime( pass.first, pass.second );
+    }
+    m_passTimes.clear();
+    m_runningPasses.clear();
+
+    // Cached analysis results refer to the module, which the caller might destroy, so they are
+    // discarded (innermost first) to ready the session for the next module.
+    m_loopAnalyses.clear();
+    m_functionAnalyses.clear();
+    m_cgsccAnalyses.clear();
+    m_moduleAnalyses.clear();
+}
+
+void CompilerSession::chargeRunningPass()
+{
+    Clock::time_point now = Clock::now();
+    if( !m_runningPasses.empty() )
+        m_passTimes[m_runningPasses.back()] += std::chrono::duration<double>( now - m_lastPassEvent ).count();
+    m_lastPassEvent = now;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CompileStats;
+
+namespace llvm {
+class Module;
+}
+
+/// A CompilerSession owns the objects that the optimizer needs for a given target machine: the
+/// TargetMachine itself, a PassBuilder, the analysis managers, and the optimization pipelines.
+/// These are constructed once and reused for every module the session optimizes, which amortizes
+/// their setup when many programs (or partitions of a program) are compiled in one process.
+///
+/// A session is not thread-safe: concurrent compilations should each use their own session.
+class CompilerSession
+{
+  public:
+    /// Construct a session that optimizes code for the specified target machine, whose LLVM target
+    /// must already be initialized.  If the target machine cannot be created, a warning is reported
+    /// and modules are optimized without target information.
+    explicit CompilerSession( llvm::orc::JITTargetMachineBuilder target );
+
+    CompilerSession( const CompilerSession& )            = delete;
+    CompilerSession& operator=( const CompilerSession& ) = delete;
+
+    /// Optimize the module using the given optimization level (0 - 3).  The module's data layout
+    /// and target triple are set to match the target machine (even at -O0).
+    void Optimize( llvm::Module* module, int optLevel );
+
+    /// Get the target machine, which might be null.  \see CompilerSession()
+    llvm::TargetMachine* GetTargetMachine() const { return m_targetMachine.get(); }
+
+    /// Record the time spent in each optimization pass in the given statistics (or stop recording,
+    /// if null).  The time of a pass excludes the passes nested within it.
+    void SetStats( CompileStats* stats ) { m_stats = stats; }
+
+  private:
+    // Members are destroyed in reverse order: the pipelines first, then the module analysis manager
+    // before the inner analysis managers that its proxies refer to, then the pass builder, and then
+    // the pass instrumentation callbacks that the pass builder and analysis managers refer to.
+    std::unique_ptr<llvm::TargetMachine> m_targetMachine;
+    llvm::PassInstrumentationCallbacks   m_instrumentation;
+    std::unique_ptr<llvm::PassBuilder>   m_passBuilder;
+    llvm::LoopAnalysisManager            m_loopAnalyses;
+    llvm::FunctionAnalysisManager        m_functionAnalyses;
+    llvm::CGSCCAnalysisManager           m_cgsccAnalyses;
+    llvm::ModuleAnalysisManager          m_moduleAnalyses;
+
+    // Optimization pipelines, indexed by optimization level, which are built on first use.
+    std::unique_ptr<llvm::ModulePassManager> m_pipelines[4];
+
+    // Pass timing, which is active when statistics are recorded.  The passes that are running form a
+    // stack (e.g. a function pass within a pass adaptor); time is charged to the innermost one.
+    // The instrumentation callbacks are declared above, since the pass builder refers to them.
+    using Clock = std::chrono::steady_clock;
+    CompileStats*                 m_stats = nullptr;
+    std::vector<std::string>      m_runningPasses;
+    Clock::time_point             m_lastPassEvent;
+    std::map<std::string, double> m_passTimes;  // seconds, not yet added to the statistics
+
+    // Charge the time since the last pass event to the innermost running pass.
+    void chargeRunningPass();
+};
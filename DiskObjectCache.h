@@ -0,0 +1,92 @@
+#pragma once
+
+#include <llvm/Config/llvm-config.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <memory>
+#include <string>
+
+/// An object cache that stores JIT-compiled object code in a directory on disk, allowing later runs
+/// on the same source to skip parsing, optimization and code generation.  Objects are named by the
+/// module identifier, which the compiler sets to a key computed by ComputeKey().
+class DiskObjectCache : public llvm::ObjectCache
+{
+  public:
+    /// Construct an object cache that stores objects in the given directory, which is created if
+    /// necessary.
+    explicit DiskObjectCache( const std::string& dir )
+        : m_dir( dir )
+    {
+        llvm::sys::fs::create_directories( m_dir );
+    }
+
+    /// Compute a cache key from everything the generated object code depends on: the source text,
+    /// the optimization level, the target machine (triple, CPU and features), and the compiler version.
+    static std::string ComputeKey( llvm::StringRef source, int optLevel, llvm::StringRef target )
+    {
+        llvm::MD5 hash;
+        hash.update( kFormatVersion );
+        hash.update( LLVM_VERSION_STRING );
+        hash.update( target );
+        hash.update( std::to_string( optLevel ) );
+        hash.update( source );
+
+        llvm::MD5::MD5Result result;
+        hash.final( result );
+        return std::string( result.digest().str() );
+    }
+
+    /// Load the object with the given key, returning null if it is not cached.
+    std::unique_ptr<llvm::MemoryBuffer> Load( llvm::StringRef key ) const
+    {
+        auto buffer = llvm::MemoryBuffer::getFile( getPath( key ), false /*isText*/,
+                                                   false /*requiresNullTerminator*/ );
+        return buffer ? std::move( *buffer ) : nullptr;
+    }
+
+    /// Called by the JIT after compiling a module.  The object is written to a temporary file and
+    /// renamed into place, so concurrent runs never observe a partially written object.
+    void notifyObjectCompiled( const llvm::Module* module, llvm::MemoryBufferRef object ) override
+    {
+        std::string path = getPath( module->getModuleIdentifier() );
+        auto        temp = llvm::sys::fs::TempFile::create( path + ".tmp-%%%%%%" );
+        if( !temp )
+        {
+            llvm::errs() << "Warning: unable to write object cache: " << llvm::toString( temp.takeError() ) << "\n";
+            return;
+        }
+        {
+            llvm::raw_fd_ostream out( temp->FD, false /*shouldClose*/ );
+            out << object.getBuffer();
+        }
+        if( llvm::Error error = temp->keep( path ) )
+            llvm::errs() << "Warning: unable to write object cache: " << llvm::toString( std::move( error ) ) << "\n";
+    }
+
+    /// Called by the JIT before compiling a module.  Returns the cached object, or null.
+    std::unique_ptr<llvm::MemoryBuffer> getObject( const llvm::Module* module ) override
+    {
+        return Load( module->getModuleIdentifier() );
+    }
+
+  private:
+    /// Bump this when the code generator changes in a way that invalidates cached objects.
+    static constexpr const char* kFormatVersion = "weekend-4";
+
+    std::string m_dir;
+
+    // Get the path of the object file with the given key.
+    std::string getPath( llvm::StringRef key ) const
+    {
+        llvm::SmallString<256> path( m_dir );
+        llvm::sys::path::append( path, key + ".o" );
+        return std::string( path.str() );
+    }
+};
@@ -1,10 +1,12 @@
 #pragma once
 
+#include "Arena.h"
+#include "Intrinsic.h"
+#include "Symbol.h"
+#include "Syntax.h"
 #include "Type.h"
 #include "Visitor.h"
 #include <iostream>
-#include <memory>
-#include <vector>
 
 /// Base class for an expression, which holds its type.
 class Exp
@@ -17,10 +19,6 @@ class Exp
     {
     }
 
-    /// The destructor is virtual, ensuring that the destructor for a derived
-    /// class will be properly invoked.
-    virtual ~Exp() {}
-
     /// Get the expression type (usually kTypeUnknown if not yet typechecked).
     Type GetType() const { return m_type; }
 
@@ -30,13 +28,14 @@ class Exp
     /// Dispatch to a visitor.  \see ExpVisitor
     virtual void* Dispatch( ExpVisitor& visitor ) = 0;
 
+  protected:
+    /// Expressions are owned by an Arena and are never deleted individually.
+    ~Exp() = default;
+
   private:
     Type m_type;
 };
 
-/// Unique pointer to expression.
-using ExpPtr = std::unique_ptr<Exp>;
-
 /// Boolean constant expression.
 class BoolExp : public Exp
 {
@@ -86,13 +85,13 @@ class VarExp : public Exp
 {
   public:
     /// Construct variable expression.
-    VarExp( const std::string& name )
+    VarExp( Symbol name )
         : m_name( name )
     {
     }
 
     /// Get the variable name.
-    const std::string& GetName() const { return m_name; }
+    Symbol GetName() const { return m_name; }
 
     /// Get the variable's declaration (null if not yet typechecked).
     const VarDecl* GetVarDecl() const { return m_varDecl; }
@@ -104,7 +103,7 @@ class VarExp : public Exp
     void* Dispatch( ExpVisitor& visitor ) override { return visitor.Visit( *this ); }
 
   private:
-    std::string    m_name;
+    Symbol         m_name;
     const VarDecl* m_varDecl;  // assigned by the typechecker.
 };
 
@@ -113,38 +112,21 @@ class VarExp : public Exp
 class CallExp : public Exp
 {
   public:
-    /// Construct function call expression with arbitrary arguments.
-    CallExp( const std::string& funcName, std::vector<ExpPtr>&& args )
-        : m_funcName( funcName )
-        , m_args( std::move( args ) )
-        , m_funcDef( nullptr )
-    {
-    }
-
-    /// Construct a unary function call (for convenience).
-    CallExp( const std::string& funcName, ExpPtr exp )
+    /// Construct function call expression with the given arguments, which are
+    /// allocated in the same Arena as the call.
+    CallExp( Symbol funcName, ArenaArray<ExpPtr> args )
         : m_funcName( funcName )
-        , m_args( 1 )
+        , m_args( args )
         , m_funcDef( nullptr )
+        , m_intrinsic( kIntrinsicNone )
     {
-        m_args[0] = std::move( exp );
-    }
-
-    /// Construct a binary function call (for convenience).
-    CallExp( const std::string& funcName, ExpPtr leftExp, ExpPtr rightExp )
-        : m_funcName( funcName )
-        , m_args( 2 )
-        , m_funcDef( nullptr )
-    {
-        m_args[0] = std::move( leftExp );
-        m_args[1] = std::move( rightExp ); 
     }
 
     /// Get the function name.
-    const std::string& GetFuncName() const { return m_funcName; }
+    Symbol GetFuncName() const { return m_funcName; }
 
     /// Get the argument expressions.
-    const std::vector<ExpPtr>& GetArgs() const { return m_args; }
+    const ArenaArray<ExpPtr>& GetArgs() const { return m_args; }
 
     /// Get the function definition (null until typechecked).
     const FuncDef* GetFuncDef() const { return m_funcDef; }
@@ -152,15 +134,19 @@ class CallExp : public Exp
     /// Link this function call to the function definition.  Called from typechecker.
     void SetFuncDef( const FuncDef* funcDef ) { m_funcDef = funcDef; }
 
+    /// Get the intrinsic opcode if this is a call to a builtin function (otherwise kIntrinsicNone).
+    Intrinsic GetIntrinsic() const { return m_intrinsic; }
+
+    /// Set the intrinsic opcode of a call to a builtin function.  Called from typechecker.
+    void SetIntrinsic( Intrinsic intrinsic ) { m_intrinsic = intrinsic; }
+
     /// Dispatch to visitor.
     void* Dispatch( ExpVisitor& visitor ) override { return visitor.Visit( *this ); }
 
   private:
-    std::string         m_funcName;
-    std::vector<ExpPtr> m_args;
-    const FuncDef*      m_funcDef;  // set by typechecker.
+    Symbol             m_funcName;
+    ArenaArray<ExpPtr> m_args;
+    const FuncDef*     m_funcDef;    // set by typechecker.
+    Intrinsic          m_intrinsic;  // set by typechecker.
 };
 
-/// Unique pointer to function call expression
-using CallExpPtr = std::unique_ptr<CallExp>;
-
@@ -1,23 +1,30 @@
 #pragma once
 
+#include "Intrinsic.h"
 #include "Stmt.h"
+#include "Symbol.h"
 #include "Syntax.h"
 #include "Type.h"
 
-#include <memory>
-#include <string>
-#include <vector>
-
 /// Syntax for function definition.
 class FuncDef
 {
   public:
-    /// Construct function definition syntax.
-    FuncDef( const Type& returnType, const std::string& name, std::vector<VarDeclPtr>&& params, SeqStmtPtr body )
+    /// Construct function definition syntax.  The parameters and body are allocated in the same
+    /// Arena as the definition.  The body is null for builtin function declarations, which
+    /// specify the intrinsic opcode that implements them.
+    FuncDef( const Type&            returnType,
+             Symbol                 name,
+             ArenaArray<VarDeclPtr> params,
+             SeqStmtPtr             body,
+             Intrinsic              intrinsic = kIntrinsicNone )
         : m_returnType( returnType )
         , m_name( name )
-        , m_params( std::move( params ) )
-        , m_body( std::move( body ) )
+        , m_params( params )
+        , m_body( body )
+        , m_intrinsic( intrinsic )
+        , m_index( -1 )
+        , m_numSlots( 0 )
     {
     }
 
@@ -25,13 +32,16 @@ class FuncDef
     const Type& GetReturnType() const { return m_returnType; }
 
     /// Get the function name.
-    const std::string& GetName() const { return m_name; }
+    Symbol GetName() const { return m_name; }
 
     /// Get the parameter declarations.
-    const std::vector<VarDeclPtr>& GetParams() const { return m_params; }
+    const ArenaArray<VarDeclPtr>& GetParams() const { return m_params; }
 
     /// Check whether the function definition has a body.  (Builtin function declarations do not.)
-    bool HasBody() const { return bool( m_body ); }
+    bool HasBody() const { return m_body != nullptr; }
+
+    /// Get the intrinsic opcode of a builtin function (kIntrinsicNone for user-defined functions).
+    Intrinsic GetIntrinsic() const { return m_intrinsic; }
 
     /// Get the function body, which is a sequence of statements.
     const SeqStmt& GetBody() const
@@ -40,13 +50,27 @@ class FuncDef
         return *m_body;
     }
 
+    /// Get the position of the function in its program, which is assigned by the typechecker.
+    /// Returns -1 if it is unassigned (e.g. for builtin declarations).
+    int GetIndex() const { return m_index; }
+
+    /// Set the position of the function in its program.  \see GetIndex
+    void SetIndex( int index ) { m_index = index; }
+
+    /// Get the number of variable slots (parameters and local variables) in the function, which
+    /// is determined by the typechecker.  \see VarDecl::GetSlot
+    int GetNumSlots() const { return m_numSlots; }
+
+    /// Set the number of variable slots in the function.
+    void SetNumSlots( int numSlots ) { m_numSlots = numSlots; }
+
   private:
-    Type                    m_returnType;
-    std::string             m_name;
-    std::vector<VarDeclPtr> m_params;
-    SeqStmtPtr              m_body;
+    Type                   m_returnType;
+    Symbol                 m_name;
+    ArenaArray<VarDeclPtr> m_params;
+    SeqStmtPtr             m_body;
+    Intrinsic              m_intrinsic;
+    int                    m_index;
+    int                    m_numSlots;
 };
 
-/// Unique pointer to a function definition.
-using FuncDefPtr = std::unique_ptr<FuncDef>;
-
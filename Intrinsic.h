@@ -0,0 +1,34 @@
+#pragma once
+
+/// Builtin operations are declared like ordinary functions (\see GetBuiltins), but each builtin
+/// declaration is tagged with an intrinsic opcode that tells the code generator which instruction(s)
+/// to emit.  The typechecker copies the opcode to each call site that resolves to a builtin.
+enum Intrinsic
+{
+    kIntrinsicNone,  // Not a builtin: an ordinary function call.
+
+    // Arithmetic
+    kIntrinsicAdd,
+    kIntrinsicSub,
+    kIntrinsicMul,
+    kIntrinsicDiv,
+    kIntrinsicMod,
+    kIntrinsicNeg,
+
+    // Equality and comparisons
+    kIntrinsicEQ,
+    kIntrinsicNE,
+    kIntrinsicLT,
+    kIntrinsicLE,
+    kIntrinsicGT,
+    kIntrinsicGE,
+
+    // Logical operations
+    kIntrinsicNot,
+    kIntrinsicAnd,
+    kIntrinsicOr,
+
+    // Type conversions
+    kIntrinsicIntToBool,
+    kIntrinsicBoolToInt
+};
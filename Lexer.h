@@ -2,10 +2,53 @@
 
 #include "Token.h"
 
+#include <cstdio>
+#include <vector>
+
 /// Scan the given string for the next token (discarding whitespace).
 /// The string pointer is passed by reference; it is advanced to the character
 /// following the token.  Discards invalid characters (with a warning).
 /// Returns kTokenEOF if the string contains no token.
 Token Lexer( const char*& source );
 
+/// Scan the given string for the next token, as above, setting "begin" to the
+/// first character of the token (following any whitespace).
+Token Lexer( const char*& source, const char*& begin );
+
+
+/// Buffered input for the streaming lexer, which reads a file (e.g. a pipe)
+/// as tokens are requested, rather than requiring the entire source in memory.
+/// Memory use is bounded by the buffer size (or the longest token, if larger).
+class LexerInput
+{
+  public:
+    /// Construct input that reads from the given file, which is not closed.
+    explicit LexerInput( std::FILE* file, size_t bufferSize = 64 * 1024 );
+
+    LexerInput( const LexerInput& )            = delete;
+    LexerInput& operator=( const LexerInput& ) = delete;
+
+    /// Returns true if an error occurred reading the file.
+    bool HasError() const { return m_error; }
+
+  private:
+    friend Token Lexer( LexerInput& input );
+
+    std::FILE*        m_file;
+    std::vector<char> m_buffer;  // null-terminated at m_limit (the sentinel)
+    const char*       m_token;   // start of the current token
+    const char*       m_cursor;  // next character to scan
+    const char*       m_marker;  // backtracking position
+    const char*       m_limit;   // end of the valid characters
+    bool              m_eof;     // true if the file has been read to the end
+    bool              m_error;
+
+    // Refill the buffer, keeping the current token.  Returns zero for success,
+    // or non-zero at the end of the input.
+    int fill();
+};
 
+/// Scan the given input for the next token (discarding whitespace), reading more
+/// of the file as necessary.  Discards invalid characters (with a warning).
+/// Returns kTokenEOF at the end of the input.
+Token Lexer( LexerInput& input );
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Exp.h"
+#include "FuncDef.h"
+#include "Symbol.h"
+#include "VarDecl.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+/// The typechecker uses an OverloadIndex to resolve calls to (possibly overloaded) functions.
+/// Function definitions are hashed by name and parameter types, so a call is resolved with a
+/// single lookup, rather than by testing each overload of the function name in turn.
+///
+/// An index can have a parent index, which takes precedence.  This allows the index of builtin
+/// operators (\see GetBuiltinIndex) to be built once and shared by all compilations.  Lookups
+/// do not modify the index, so it can be shared by concurrent typecheckers.
+class OverloadIndex
+{
+  public:
+    /// Construct an empty index with an optional parent index, which must outlive this one.
+    explicit OverloadIndex( const OverloadIndex* parent = nullptr )
+        : m_parent( parent )
+    {
+    }
+
+    OverloadIndex( const OverloadIndex& )            = delete;
+    OverloadIndex& operator=( const OverloadIndex& ) = delete;
+
+    /// Reserve space for the given number of functions.
+    void Reserve( size_t numFunctions ) { m_map.reserve( numFunctions ); }
+
+    /// Add the given function definition.  Returns false (without adding it) if a function with the
+    /// same name and parameter types was already added (to this index or its parent), in which case
+    /// calls continue to resolve to the earlier definition.
+    bool Insert( const FuncDef* funcDef )
+    {
+        const ArenaArray<VarDeclPtr>& params = funcDef->GetParams();
+        if( find( funcDef->GetName(), params ) )
+            return false;
+        m_map.emplace( makeKey( funcDef->GetName(), params ), funcDef );
+        return true;
+    }
+
+    /// Find the function definition with the specified name whose parameter types match the types of
+    /// the given (typechecked) arguments.  Returns null if there is no such function.
+    const FuncDef* Find( Symbol name, const ArenaArray<ExpPtr>& args ) const { return find( name, args ); }
+
+  private:
+    // The key is the name, the number of parameters, and the parameter types packed into two bits
+    // apiece.  Only the first 32 types are packed, so keys of long signatures might collide, and the
+    // parameter types of each candidate are compared with the argument types.
+    struct Key
+    {
+        uint32_t name;
+        uint32_t arity;
+        uint64_t types;
+
+        bool operator==( const Key& other ) const
+        {
+            return name == other.name && arity == other.arity && types == other.types;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()( const Key& key ) const
+        {
+            uint64_t hash = ( uint64_t( key.name ) << 32 | key.arity ) * 0x9E3779B97F4A7C15ull;
+            return static_cast<size_t>( ( hash ^ key.types ) * 0xC2B2AE3D27D4EB4Full >> 16 );
+        }
+    };
+
+    std::unordered_multimap<Key, const FuncDef*, KeyHash> m_map;
+    const OverloadIndex*                                  m_parent;
+
+    // Make the key for the given name and parameters (or arguments), which have a GetType() method.
+    template <typename T>
+    static Key makeKey( Symbol name, const ArenaArray<T>& elements )
+    {
+        Key key = { name.GetId(), static_cast<uint32_t>( elements.size() ), 0 };
+        for( size_t i = 0; i < elements.size() && i < 32; ++i )
+            key.types |= uint64_t( elements[i]->GetType() ) << ( 2 * i );
+        return key;
+    }
+
+    // Find a function with the given name whose parameter types match the types of the given
+    // parameters or arguments, looking in the parent index first.
+    template <typename T>
+    const FuncDef* find( Symbol name, const ArenaArray<T>& elements ) const
+    {
+        if( m_parent )
+        {
+            if( const FuncDef* funcDef = m_parent->find( name, elements ) )
+                return funcDef;
+        }
+        auto range = m_map.equal_range( makeKey( name, elements ) );
+        for( auto it = range.first; it != range.second; ++it )
+        {
+            if( typesMatch( it->second->GetParams(), elements ) )
+                return it->second;
+        }
+        return nullptr;
+    }
+
+    // Check whether the given function parameters have the same types as the given parameters or
+    // arguments.
+    template <typename T>
+    static bool typesMatch( const ArenaArray<VarDeclPtr>& params, const ArenaArray<T>& elements )
+    {
+        if( params.size() != elements.size() )
+            return false;
+        for( size_t i = 0; i < params.size(); ++i )
+        {
+            if( params[i]->GetType() != elements[i]->GetType() )
+                return false;
+        }
+        return true;
+    }
+};
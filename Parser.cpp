@@ -3,8 +3,14 @@
 #include "FuncDef.h"
 #include "Program.h"
 #include "Stmt.h"
+#include "TokenBuffer.h"
 #include "TokenStream.h"
 
+#include <llvm/Support/ThreadPool.h>
+
+#include <cstring>
+#include <memory>
+
 namespace {
 
 // Exceptions are used internally by the parser to simplify error checking.
@@ -19,11 +25,11 @@ class ParseError : public std::runtime_error
     }
 };
 
-// Forward declarations
-ExpPtr parseExp( TokenStream& tokens );
-std::vector<ExpPtr> parseArgs( TokenStream& tokens );
-SeqStmtPtr parseSeq( TokenStream& tokens );
-ExpPtr parseRemainingExp( ExpPtr leftExp, int leftPrecedence, TokenStream& tokens );
+// Forward declarations.  Syntax nodes are allocated in the given Arena.
+ExpPtr parseExp( TokenStream& tokens, Arena& arena );
+ArenaArray<ExpPtr> parseArgs( TokenStream& tokens, Arena& arena );
+SeqStmtPtr parseSeq( TokenStream& tokens, Arena& arena );
+ExpPtr parseRemainingExp( ExpPtr leftExp, int leftPrecedence, TokenStream& tokens, Arena& arena );
 int getPrecedence( const Token& token );
 
     
@@ -42,7 +48,7 @@ void skipToken( const Token& expected, TokenStream& tokens )
 //             | Id ( Args )
 //             | ( Exp )
 //             | UnaryOp PrimaryExp
-ExpPtr parsePrimaryExp( TokenStream& tokens )
+ExpPtr parsePrimaryExp( TokenStream& tokens, Arena& arena )
 {
     // Fetch the next token, advancing the token stream.  (Note that this
     // dereferences, then increments the TokenStream.)
@@ -51,43 +57,42 @@ ExpPtr parsePrimaryExp( TokenStream& tokens )
     {
         // Boolean constant?
         case kTokenTrue:
-            return std::make_unique<BoolExp>( true );
+            return arena.New<BoolExp>( true );
         case kTokenFalse:
-            return std::make_unique<BoolExp>( false );
+            return arena.New<BoolExp>( false );
         // Integer constant?
         case kTokenNum:
-            return std::make_unique<IntExp>( token.GetNum() );
+            return arena.New<IntExp>( token.GetNum() );
         // An identifier might be a variable or the start of a function call.
         case kTokenId:
         {
             // If the next token is a left paren, it's a function call.
             if( *tokens == kTokenLparen )
                 // Parse argument expressions and construct CallExp.
-                return std::make_unique<CallExp>( token.GetId(), parseArgs( tokens ) );
+                return arena.New<CallExp>( token.GetId(), parseArgs( tokens, arena ) );
             else
                 // Construct VarExp
-                return std::make_unique<VarExp>( token.GetId() );
+                return arena.New<VarExp>( token.GetId() );
         }
         // Type conversion?
         case kTokenBool:
         case kTokenInt:
         {
-            return std::make_unique<CallExp>( token.ToString(), parseArgs( tokens ) );
+            return arena.New<CallExp>( token.ToSymbol(), parseArgs( tokens, arena ) );
         }
-        // Parenthesized expression?
+        // Parenthesized expression?  (The left paren has been consumed.)
         case kTokenLparen:
         {
-            skipToken( kTokenLparen, tokens );
-            ExpPtr exp( parseExp( tokens ) );
+            ExpPtr exp( parseExp( tokens, arena ) );
             skipToken( kTokenRparen, tokens );
             return exp;
         }
-        // Prefix minus?
+        // Prefix minus or logical negation?  (The operator has been consumed.)
         case kTokenMinus:
+        case kTokenNot:
         {
-            Token unaryOp( *tokens++ );
-            ExpPtr exp( parsePrimaryExp( tokens ) );
-            return std::make_unique<CallExp>( unaryOp.ToString(), std::move( exp ) );
+            ExpPtr exp( parsePrimaryExp( tokens, arena ) );
+            return arena.New<CallExp>( token.ToSymbol(), arena.NewArray( { exp } ) );
         }
         default:
             throw ParseError( std::string( "Unexpected token: " ) + token.ToString() );
@@ -98,33 +103,33 @@ ExpPtr parsePrimaryExp( TokenStream& tokens )
 // Args    -> ( ArgList )
 // ArgList -> Exp
 //          | Exp , ArgList
-std::vector<ExpPtr> parseArgs( TokenStream& tokens )
+ArenaArray<ExpPtr> parseArgs( TokenStream& tokens, Arena& arena )
 {
     skipToken( kTokenLparen, tokens );
     std::vector<ExpPtr> exps;
     if( *tokens != kTokenRparen )
     {
-        exps.push_back( parseExp( tokens ) );
+        exps.push_back( parseExp( tokens, arena ) );
         while( *tokens == kTokenComma )
         {
-            exps.push_back( parseExp( ++tokens ) );
+            exps.push_back( parseExp( ++tokens, arena ) );
         }
     }
     skipToken( kTokenRparen, tokens );
 
-    return exps;
+    return arena.NewArray( exps );
 }
 
 
 // Parse an expression with infix operators.
-ExpPtr parseExp( TokenStream& tokens )
+ExpPtr parseExp( TokenStream& tokens, Arena& arena )
 {
     // First, parse a primary expression, which contains no infix operators.
-    ExpPtr leftExp( parsePrimaryExp( tokens ) );
+    ExpPtr leftExp( parsePrimaryExp( tokens, arena ) );
 
     // The next token might be an operator.  Call a helper routine
     // to parse the remainder of the expression.
-    return parseRemainingExp( std::move( leftExp ), 0 /*initial precedence*/, tokens );
+    return parseRemainingExp( leftExp, 0 /*initial precedence*/, tokens, arena );
 }
 
 // This routine implements an operator precedence expression parser.
@@ -136,7 +141,7 @@ ExpPtr parseExp( TokenStream& tokens )
 // After parsing an expression (leftExp) whose operator has the given
 // precedence (or zero if it has no operator), parse the remainder of
 // the expression from the given token stream.
-ExpPtr parseRemainingExp( ExpPtr leftExp, int leftPrecedence, TokenStream& tokens )
+ExpPtr parseRemainingExp( ExpPtr leftExp, int leftPrecedence, TokenStream& tokens, Arena& arena )
 {
     while( true )
     {
@@ -148,18 +153,17 @@ ExpPtr parseRemainingExp( ExpPtr leftExp, int leftPrecedence, TokenStream& token
 
         // Parse the current operator and the current primary expression.
         Token opToken( *tokens++ );
-        ExpPtr rightExp = parsePrimaryExp( tokens );
+        ExpPtr rightExp = parsePrimaryExp( tokens, arena );
 
         // If the next operator has higher precedence, it claims the current expression.
         int rightPrecedence = getPrecedence( *tokens );
         if( rightPrecedence > precedence )
         {
-            rightExp = parseRemainingExp( std::move( rightExp ), precedence + 1, tokens );
+            rightExp = parseRemainingExp( rightExp, precedence + 1, tokens, arena );
         }
 
         // Construct a call expression with the left and right expressions.
-        leftExp = std::make_unique<CallExp>( opToken.ToString(),
-                                             std::move( leftExp ), std::move( rightExp ) );
+        leftExp = arena.New<CallExp>( opToken.ToSymbol(), arena.NewArray( { leftExp, rightExp } ) );
     }
 }
 
@@ -210,7 +214,7 @@ Type parseType( TokenStream& tokens )
 }
 
 // Parse an identifier.
-std::string parseId( TokenStream& tokens )
+Symbol parseId( TokenStream& tokens )
 {
     Token id( *tokens++ );
     if( id.GetTag() != kTokenId )
@@ -220,11 +224,11 @@ std::string parseId( TokenStream& tokens )
 
 
 // VarDecl -> Type Id
-VarDeclPtr parseVarDecl( VarDecl::Kind kind, TokenStream& tokens )
+VarDeclPtr parseVarDecl( VarDecl::Kind kind, TokenStream& tokens, Arena& arena )
 {
     Type        type( parseType( tokens ) );
-    std::string id( parseId( tokens ) );
-    return std::make_unique<VarDecl>( kind, type, id );
+    Symbol id( parseId( tokens ) );
+    return arena.New<VarDecl>( kind, type, id );
 }
 
     
@@ -236,7 +240,7 @@ VarDeclPtr parseVarDecl( VarDecl::Kind kind, TokenStream& tokens )
 //       | if ( Exp ) Stmt
 //       | if ( Exp ) Stmt else Stmt
 //       | while ( Exp ) Stmt
-StmtPtr parseStmt( TokenStream& tokens )
+StmtPtr parseStmt( TokenStream& tokens, Arena& arena )
 {
     Token token( *tokens );
     switch( token.GetTag() )
@@ -247,69 +251,69 @@ StmtPtr parseStmt( TokenStream& tokens )
             if( *tokens == kTokenAssign )
             {
                 // Assignment
-                ExpPtr rvalue( parseExp( ++tokens ) );
+                ExpPtr rvalue( parseExp( ++tokens, arena ) );
                 skipToken( kTokenSemicolon, tokens );
-                return std::make_unique<AssignStmt>( id.GetId(), std::move( rvalue ) );
+                return arena.New<AssignStmt>( id.GetId(), rvalue );
             }
             else
             {
                 // Call
-                std::vector<ExpPtr> args( parseArgs( tokens ) );
-                CallExpPtr          callExp( std::make_unique<CallExp>( id.GetId(), std::move( args ) ) );
+                ArenaArray<ExpPtr> args( parseArgs( tokens, arena ) );
+                CallExpPtr         callExp( arena.New<CallExp>( id.GetId(), args ) );
                 skipToken( kTokenSemicolon, tokens );
-                return std::make_unique<CallStmt>( std::move( callExp ) );
+                return arena.New<CallStmt>( callExp );
             }
         }
         case kTokenInt:
         case kTokenBool:
         {
             // Declaration
-            VarDeclPtr varDecl( parseVarDecl( VarDecl::kLocal, tokens ) );
-            ExpPtr     initExp;
+            VarDeclPtr varDecl( parseVarDecl( VarDecl::kLocal, tokens, arena ) );
+            ExpPtr     initExp = nullptr;
             if( *tokens == kTokenAssign )
             {
-                initExp = parseExp( ++tokens );
+                initExp = parseExp( ++tokens, arena );
             }
             skipToken( kTokenSemicolon, tokens );
-            return std::make_unique<DeclStmt>( std::move( varDecl ), std::move( initExp ) );
+            return arena.New<DeclStmt>( varDecl, initExp );
         }
         case kTokenLbrace:
         {
             // Sequence
-            return parseSeq( tokens );
+            return parseSeq( tokens, arena );
         }
         case kTokenReturn:
         {
             ++tokens;  // skip "return"
-            ExpPtr returnExp( parseExp( tokens ) );
+            ExpPtr returnExp( parseExp( tokens, arena ) );
             skipToken( kTokenSemicolon, tokens );
-            return std::make_unique<ReturnStmt>( std::move( returnExp ) );
+            return arena.New<ReturnStmt>( returnExp );
         }
         case kTokenIf:
         {
             ++tokens;  // skip "if"
             skipToken( kTokenLparen, tokens );
-            ExpPtr condExp( parseExp( tokens ) );
+            ExpPtr condExp( parseExp( tokens, arena ) );
             skipToken( kTokenRparen, tokens );
 
-            StmtPtr thenStmt( parseStmt( tokens ) );
-            StmtPtr elseStmt;
+            StmtPtr thenStmt( parseStmt( tokens, arena ) );
+            StmtPtr elseStmt = nullptr;
             if( *tokens == kTokenElse )
             {
                 ++tokens;  // skip "else"
-                elseStmt = parseStmt( tokens );
+                elseStmt = parseStmt( tokens, arena );
             }
-            return std::make_unique<IfStmt>( std::move( condExp ), std::move( thenStmt ), std::move( elseStmt ) );
+            return arena.New<IfStmt>( condExp, thenStmt, elseStmt );
         }
         case kTokenWhile:
         {
             ++tokens;  // skip "while"
             skipToken( kTokenLparen, tokens );
-            ExpPtr condExp( parseExp( tokens ) );
+            ExpPtr condExp( parseExp( tokens, arena ) );
             skipToken( kTokenRparen, tokens );
 
-            StmtPtr bodyStmt( parseStmt( tokens ) );
-            return std::make_unique<WhileStmt>( std::move( condExp ), std::move( bodyStmt ) );
+            StmtPtr bodyStmt( parseStmt( tokens, arena ) );
+            return arena.New<WhileStmt>( condExp, bodyStmt );
         }
         default:
             throw ParseError( std::string( "Unexpected token: " ) + token.ToString() );
@@ -317,20 +321,20 @@ StmtPtr parseStmt( TokenStream& tokens )
 }
 
 // Seq -> { Stmt* }
-SeqStmtPtr parseSeq( TokenStream& tokens )
+SeqStmtPtr parseSeq( TokenStream& tokens, Arena& arena )
 {
     skipToken( kTokenLbrace, tokens );
     std::vector<StmtPtr> stmts;
     while( *tokens != kTokenRbrace )
     {
-        stmts.push_back( parseStmt( tokens ) );
+        stmts.push_back( parseStmt( tokens, arena ) );
     }
     skipToken( kTokenRbrace, tokens );
-    return std::make_unique<SeqStmt>( std::move( stmts ) );
+    return arena.New<SeqStmt>( arena.NewArray( stmts ) );
 }
 
 // FuncId -> Id | operator BinaryOp
-std::string parseFuncId( TokenStream& tokens )
+Symbol parseFuncId( TokenStream& tokens )
 {
     if( *tokens == kTokenOperator )
     {
@@ -338,43 +342,83 @@ std::string parseFuncId( TokenStream& tokens )
         Token op( *tokens++ );
         if( !op.IsOperator() )
             throw ParseError( "Invalid operator" );
-        return op.ToString();
+        return op.ToSymbol();
     }
     else
         return parseId( tokens );
 }
 
 // FuncDef -> Type Id ( VarDecl* ) Seq
-FuncDefPtr parseFuncDef( TokenStream& tokens )
+FuncDefPtr parseFuncDef( TokenStream& tokens, Arena& arena )
 {
     // Parse return type and function id.
-    Type        returnType( parseType( tokens ) );
-    std::string id( parseFuncId( tokens ) );
+    Type   returnType( parseType( tokens ) );
+    Symbol id( parseFuncId( tokens ) );
 
     // Parse parameter declarations
     skipToken( kTokenLparen, tokens );
     std::vector<VarDeclPtr> params;
     if( *tokens != kTokenRparen )
     {
-        params.push_back( parseVarDecl( VarDecl::kParam, tokens ) );
+        params.push_back( parseVarDecl( VarDecl::kParam, tokens, arena ) );
         while( *tokens != kTokenRparen )
         {
             skipToken( kTokenComma, tokens );
-            params.push_back( parseVarDecl( VarDecl::kParam, tokens ) );
+            params.push_back( parseVarDecl( VarDecl::kParam, tokens, arena ) );
         }
     }
     skipToken( kTokenRparen, tokens );
 
     // Parse function body (if any);
-    SeqStmtPtr body;
+    SeqStmtPtr body = nullptr;
     if( *tokens == kTokenLbrace )
-        body = parseSeq( tokens );
+        body = parseSeq( tokens, arena );
     else
         skipToken( kTokenSemicolon, tokens );
 
-    return std::make_unique<FuncDef>( returnType, id, std::move( params ), std::move( body ) );
+    return arena.New<FuncDef>( returnType, id, arena.NewArray( params ), body );
+}
+
+// Program -> FuncDef+
+void parseFuncDefs( TokenStream& tokens, Arena& arena, std::vector<FuncDefPtr>* functions )
+{
+    do {
+        functions->push_back( parseFuncDef( tokens, arena ) );
+    } while( *tokens != kTokenEOF );
+}
+
+// Find the end of each top-level function definition in the given source, which is just past the
+// closing brace of its body, or the semicolon that ends a declaration.  The language has no comments
+// or string literals, so braces can be matched character by character.  Unbalanced braces yield
+// bogus boundaries, but the parser reports an error in that case anyway.
+std::vector<size_t> findFuncDefEnds( const char* source, size_t length )
+{
+    std::vector<size_t> ends;
+    int depth = 0;
+    for( size_t i = 0; i < length; ++i )
+    {
+        if( source[i] == '{' )
+            ++depth;
+        else if( ( source[i] == '}' && --depth <= 0 ) || ( source[i] == ';' && depth <= 0 ) )
+        {
+            ends.push_back( i + 1 );
+            depth = 0;
+        }
+    }
+    return ends;
 }
 
+// The function definitions parsed from one range of the source, in an arena of their own.
+struct ParsedRange
+{
+    size_t                  begin = 0;
+    size_t                  end   = 0;  // end of the source, for the last range
+    Arena                   arena;
+    std::vector<FuncDefPtr> functions;
+    size_t                  numTokens = 0;
+    bool                    failed    = false;
+};
+
 } // anonymouse namespace
 
 // Parse the given tokens, adding function definitions to the given program.
@@ -383,15 +427,92 @@ int ParseProgram( TokenStream& tokens, Program* program )
 {
     try
     {
-        do {
-            FuncDefPtr function( parseFuncDef( tokens ) );
-            program->GetFunctions().push_back( std::move( function ) );
-        } while( *tokens != kTokenEOF );
+        parseFuncDefs( tokens, program->GetArena(), &program->GetFunctions() );
         return 0;
     }
     catch( const ParseError& error )
     {
-        std::cerr << "Error: " << error.what() << std::endl;
+        std::cerr << "Error";
+        if( int line = tokens.GetLine() )
+            std::cerr << " at line " << line;
+        std::cerr << ": " << error.what() << std::endl;
         return -1;
     }
 }
+
+// The source is divided into ranges of whole function definitions, of roughly equal size, and
+// each range is lexed and parsed by a separate task into an arena of its own.  There are a few
+// more ranges than threads, which balances the load when function sizes vary.  The results are
+// then merged in source order.  If any range fails to parse, the entire source is parsed again
+// on one thread, which reports the same error as sequential parsing would.
+int ParseProgram( const char* source, Program* program, int numThreads, size_t* numTokens )
+{
+    const size_t kRangesPerThread = 4;
+    size_t       length           = std::strlen( source );
+    std::vector<size_t> ends      = findFuncDefEnds( source, length );
+    size_t numRanges = std::min( ends.size(), numThreads > 1 ? numThreads * kRangesPerThread : 1 );
+    if( numRanges <= 1 )
+    {
+        TokenBuffer buffer( source );
+        TokenStream tokens( &buffer );
+        int         status = ParseProgram( tokens, program );
+        if( numTokens )
+            *numTokens = tokens.GetNumTokens();
+        return status;
+    }
+
+    // Choose the range boundaries from the ends of the function definitions.  The last range
+    // extends to the end of the source, so any trailing tokens are parsed (and rejected).
+    std::vector<std::unique_ptr<ParsedRange>> ranges;
+    size_t end = 0;
+    for( size_t i = 0; i + 1 < ends.size() && ranges.size() + 1 < numRanges; ++i )
+    {
+        if( ends[i] < length * ( ranges.size() + 1 ) / numRanges )
+            continue;
+        ranges.emplace_back( new ParsedRange );
+        ranges.back()->begin = end;
+        ranges.back()->end   = end = ends[i];
+    }
+    ranges.emplace_back( new ParsedRange );
+    ranges.back()->begin = end;
+    ranges.back()->end   = length;
+
+    auto parseRange = [source]( ParsedRange* range ) {
+        TokenBuffer buffer( source, source + range->begin, source + range->end );
+        TokenStream tokens( &buffer );
+        try
+        {
+            parseFuncDefs( tokens, range->arena, &range->functions );
+        }
+        catch( const ParseError& )
+        {
+            range->failed = true;
+        }
+        range->numTokens = tokens.GetNumTokens();
+    };
+    {
+        llvm::DefaultThreadPool pool( llvm::hardware_concurrency( numThreads ) );
+        for( std::unique_ptr<ParsedRange>& range : ranges )
+            pool.async( parseRange, range.get() );
+        pool.wait();
+    }
+    for( const std::unique_ptr<ParsedRange>& range : ranges )
+    {
+        if( range->failed )
+            return ParseProgram( source, program, 1, numTokens );
+    }
+
+    // Merge the results in source order.  Each range has its own end token, but a single
+    // stream would have had only one.
+    if( numTokens )
+        *numTokens = 1;
+    for( std::unique_ptr<ParsedRange>& range : ranges )
+    {
+        program->GetArena().Merge( range->arena );
+        program->GetFunctions().insert( program->GetFunctions().end(), range->functions.begin(),
+                                        range->functions.end() );
+        if( numTokens )
+            *numTokens += range->numTokens - 1;
+    }
+    return 0;
+}
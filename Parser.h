@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 class Program;
 class TokenStream;
 
@@ -7,4 +9,11 @@ class TokenStream;
 /// Returns zero for success (otherwise an error message is reported).
 int ParseProgram( TokenStream& tokens, Program* program );
 
+/// Parse the given null-terminated source code, adding function definitions to
+/// the given program.  The function definitions are lexed and parsed on the
+/// given number of threads, but they are added to the program in source order.
+/// The number of tokens is returned via the optional numTokens argument.
+/// Returns zero for success (otherwise an error message is reported).
+int ParseProgram( const char* source, Program* program, int numThreads, size_t* numTokens = nullptr );
+
 
@@ -1,11 +1,13 @@
 #pragma once
 
-#include <memory>
+#include "Arena.h"
+#include "Syntax.h"
 
-class FuncDef;
-using FuncDefPtr = std::unique_ptr<FuncDef>;
+#include <vector>
 
 /// Syntax for a program, which is simply a vector of function definitions.
+/// The program owns an Arena that holds all of its syntax nodes, which are
+/// freed together when the program is destroyed.
 class Program
 {
   public:
@@ -13,10 +15,13 @@ class Program
 
     std::vector<FuncDefPtr>& GetFunctions() { return m_functions; }
 
+    /// Get the arena that holds the syntax of this program.
+    Arena& GetArena() { return m_arena; }
+
+    /// Get the arena that holds the syntax of this program.
+    const Arena& GetArena() const { return m_arena; }
+
   private:
+    Arena                   m_arena;
     std::vector<FuncDefPtr> m_functions;
 };
-
-using ProgramPtr = std::unique_ptr<Program>;
-
-
@@ -0,0 +1,206 @@
+#include "ProgramGenerator.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Number of iterations of the loops within generated functions.
+const int kInnerIterations = 4;
+
+// Generates a program of a given shape.  A simple xorshift generator is used rather than the
+// standard distributions, whose results vary between library implementations.
+class Generator
+{
+  public:
+    explicit Generator( const ProgramShape& shape )
+        : m_shape( shape )
+        , m_state( shape.seed ? shape.seed : 1 )
+    {
+    }
+
+    std::string Generate()
+    {
+        if( m_shape.numOverloads > 0 )
+            generateOperators();
+        for( int i = 0; i < m_shape.numOverloads; ++i )
+            generateOverloads( i );
+        for( int i = 0; i < std::max( m_shape.numFunctions, 1 ); ++i )
+            generateFunction( i );
+        generateMain();
+        return m_out;
+    }
+
+  private:
+    const ProgramShape&      m_shape;
+    uint32_t                 m_state;
+    std::string              m_out;
+    std::vector<std::string> m_vars;  // int variables in scope
+
+    // Get a pseudo-random number in [0, n).
+    int random( int n )
+    {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return static_cast<int>( m_state % static_cast<uint32_t>( n ) );
+    }
+
+    // Operators on booleans, which make operator overloading more expensive to resolve.
+    void generateOperators()
+    {
+        m_out += "int operator+(bool a, bool b)\n{\n    int n = 0;\n    if (a) n = n + 1;\n"
+                 "    if (b) n = n + 1;\n    return n;\n}\n\n";
+        m_out += "int operator*(bool a, int x)\n{\n    if (a) return x;\n    return 0;\n}\n\n";
+    }
+
+    // A family of overloaded functions, named "ov<index>", that differ in their parameter types.
+    void generateOverloads( int index )
+    {
+        std::string name = "ov" + std::to_string( index );
+        std::string k    = std::to_string( index % 97 + 1 );
+        m_out += "int " + name + "(int x)\n{\n    return x + " + k + ";\n}\n\n";
+        m_out += "int " + name + "(bool b)\n{\n    if (b) return " + k + ";\n    return 0 - " + k + ";\n}\n\n";
+        m_out += "int " + name + "(int x, int y)\n{\n    return x * " + k + " + y;\n}\n\n";
+        m_out += "int " + name + "(int x, bool b)\n{\n    if (b) return x;\n    return x + " + k + ";\n}\n\n";
+    }
+
+    // Generate an integer expression of at most the given depth.  Operators are separated from their
+    // operands by spaces, since the lexer treats "-1" as a literal.
+    std::string intExp( int depth )
+    {
+        if( depth <= 0 || random( 8 ) == 0 )
+        {
+            if( m_vars.empty() || random( 4 ) == 0 )
+                return std::to_string( random( 100 ) );
+            return m_vars[random( static_cast<int>( m_vars.size() ) )];
+        }
+        int numChoices = m_shape.numOverloads > 0 ? 9 : 6;
+        switch( random( numChoices ) )
+        {
+            case 0:
+                return "(" + intExp( depth - 1 ) + " + " + intExp( depth - 1 ) + ")";
+            case 1:
+                return "(" + intExp( depth - 1 ) + " - " + intExp( depth - 1 ) + ")";
+            case 2:
+                return "(" + intExp( depth - 1 ) + " * " + intExp( depth - 1 ) + ")";
+            case 3:
+                return "(" + intExp( depth - 1 ) + " / " + std::to_string( random( 9 ) + 1 ) + ")";
+            case 4:
+                return "(" + intExp( depth - 1 ) + " % " + std::to_string( random( 9 ) + 1 ) + ")";
+            case 5:
+                return "(- " + intExp( depth - 1 ) + ")";
+            case 6:
+                return overloadCall( depth - 1 );
+            case 7:
+                return "(" + boolExp( depth - 1 ) + " + " + boolExp( depth - 1 ) + ")";
+            default:
+                return "(" + boolExp( depth - 1 ) + " * " + intExp( depth - 1 ) + ")";
+        }
+    }
+
+    // Generate a boolean expression of at most the given depth.
+    std::string boolExp( int depth )
+    {
+        static const char* const kComparisons[] = { " < ", " <= ", " > ", " >= ", " == ", " != " };
+        if( depth <= 0 || random( 8 ) == 0 )
+        {
+            if( random( 4 ) == 0 )
+                return random( 2 ) ? "true" : "false";
+            return "(" + intExp( 0 ) + kComparisons[random( 6 )] + intExp( 0 ) + ")";
+        }
+        switch( random( 5 ) )
+        {
+            case 0:
+                return "(" + intExp( depth - 1 ) + kComparisons[random( 6 )] + intExp( depth - 1 ) + ")";
+            case 1:
+                return "(! " + boolExp( depth - 1 ) + ")";
+            case 2:
+                return "(" + boolExp( depth - 1 ) + " && " + boolExp( depth - 1 ) + ")";
+            case 3:
+                return "(" + boolExp( depth - 1 ) + " || " + boolExp( depth - 1 ) + ")";
+            default:
+                return "(" + boolExp( depth - 1 ) + " == " + boolExp( depth - 1 ) + ")";
+        }
+    }
+
+    // Generate a call to one of the overloaded functions.
+    std::string overloadCall( int depth )
+    {
+        std::string name = "ov" + std::to_string( random( m_shape.numOverloads ) );
+        switch( random( 4 ) )
+        {
+            case 0:
+                return name + "(" + intExp( depth ) + ")";
+            case 1:
+                return name + "(" + boolExp( depth ) + ")";
+            case 2:
+                return name + "(" + intExp( depth ) + ", " + intExp( depth ) + ")";
+            default:
+                return name + "(" + intExp( depth ) + ", " + boolExp( depth ) + ")";
+        }
+    }
+
+    // Generate a function named "f<index>", which calls the previous function (if any).
+    void generateFunction( int index )
+    {
+        int depth = m_shape.expressionDepth;
+        m_vars    = { "x", "y" };
+        m_out += "int f" + std::to_string( index ) + "(int x, int y)\n{\n";
+        m_out += "    int v0 = " + intExp( depth ) + ";\n";
+        m_vars.push_back( "v0" );
+        int numLocals = 1;
+        for( int i = 1; i < m_shape.numStatements; ++i )
+        {
+            std::string local = "v" + std::to_string( random( numLocals ) );
+            switch( random( 4 ) )
+            {
+                case 0:
+                {
+                    std::string var = "v" + std::to_string( numLocals++ );
+                    m_out += "    int " + var + " = " + intExp( depth ) + ";\n";
+                    m_vars.push_back( var );
+                    break;
+                }
+                case 1:
+                    m_out += "    " + local + " = " + intExp( depth ) + ";\n";
+                    break;
+                case 2:
+                    m_out += "    if (" + boolExp( depth ) + ")\n        " + local + " = " + intExp( depth ) +
+                             ";\n    else\n        " + local + " = " + intExp( depth ) + ";\n";
+                    break;
+                default:
+                {
+                    // The loop counter is not added to the variables in scope, so it is never assigned.
+                    std::string counter = "i" + std::to_string( i );
+                    m_out += "    {\n        int " + counter + " = 0;\n        while (" + counter + " < " +
+                             std::to_string( kInnerIterations ) + ")\n        {\n            " + local + " = " +
+                             local + " + " + intExp( depth ) + ";\n            " + counter + " = " + counter +
+                             " + 1;\n        }\n    }\n";
+                    break;
+                }
+            }
+        }
+        std::string result = intExp( depth );
+        if( index > 0 )
+            result += " + f" + std::to_string( index - 1 ) + "(v0, y)";
+        m_out += "    return " + result + ";\n}\n\n";
+    }
+
+    // Generate the main function, which calls the last function in a loop.
+    void generateMain()
+    {
+        m_out += "int main(int x)\n{\n    int sum = 0;\n    int i = 0;\n    while (i < " +
+                 std::to_string( m_shape.loopIterations ) + ")\n    {\n        sum = sum + f" +
+                 std::to_string( std::max( m_shape.numFunctions, 1 ) - 1 ) +
+                 "(i, x);\n        i = i + 1;\n    }\n    return sum;\n}\n";
+    }
+};
+
+}  // anonymous namespace
+
+std::string GenerateProgram( const ProgramShape& shape )
+{
+    return Generator( shape ).Generate();
+}
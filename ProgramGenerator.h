@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/// The shape of a synthetic program, for benchmarking.  Each parameter scales one aspect of the
+/// program independently of the others.
+struct ProgramShape
+{
+    int      numFunctions    = 10;   // number of generated functions (each calls the previous one)
+    int      numStatements   = 8;    // number of statements in each function
+    int      expressionDepth = 3;    // depth of generated expression trees
+    int      loopIterations  = 100;  // number of iterations of the loop in main
+    int      numOverloads    = 0;    // number of overloaded function families, which expressions call
+    uint32_t seed            = 1;    // seed for the pseudo-random choices, so programs are reproducible
+};
+
+/// Generate the source code of a program with the given shape.  The program is the same on every
+/// platform for a given shape.  It contains only well-defined operations (e.g. it never divides by
+/// zero), and main(x) takes time proportional to loopIterations * numFunctions * numStatements.
+std::string GenerateProgram( const ProgramShape& shape );
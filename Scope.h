@@ -1,48 +1,95 @@
 #pragma once
 
+#include "Symbol.h"
 #include "VarDecl.h"
-#include <string>
-#include <unordered_map>
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
 
 /// The typechecker uses a Scope to resolve lexical scoping.  A Scope maps
-/// variable names to variable declarations.  A Scope has a parent pointer
-/// that links to the enclosing scope.  This allows local variables to shadow
-/// function parameters, etc.
+/// variable names to variable declarations.  Nested lexical scopes are entered
+/// and exited with Push and Pop, and a declaration in a nested scope shadows
+/// any declaration of the same name in an enclosing scope (e.g. a local
+/// variable can shadow a function parameter).
+///
+/// The table is flat: each name has a stack of bindings, whose top is the
+/// innermost declaration, so lookup takes constant time regardless of the
+/// depth of nesting.  The bindings are kept in an undo log, in order of
+/// declaration, which Pop truncates to the mark left by the matching Push.
+/// Entering and exiting a scope does not allocate memory, and a Scope can be
+/// reused for any number of functions.
 class Scope
 {
   public:
-    /// Construct a scope with an optional parent scope.
-    explicit Scope( const Scope* parent = nullptr )
-        : m_map()
-        , m_parent( parent )
+    /// Construct an empty scope table.
+    Scope()
+        : m_depth( 0 )
     {
     }
 
-    /// Look up the variable with the specified name, delegating to the parent
-    /// scope if not found.  Returns null if the variable is not defined.
-    const VarDecl* Find( const std::string& name ) const
+    /// Look up the innermost declaration of the variable with the specified
+    /// name.  Returns null if the variable is not defined.
+    const VarDecl* Find( Symbol name ) const
     {
-        MapType::const_iterator it = m_map.find( name );
-        if( it != m_map.end() )
-            return it->second;
-        else
-            return m_parent ? m_parent->Find( name ) : nullptr;
+        int32_t binding = getTop( name );
+        return binding >= 0 ? m_bindings[binding].varDecl : nullptr;
     }
 
-    /// Add the given variable declaration to this scope.  The variable
-    /// declaration might be a function parameter or a local variable.
-    /// Returns true for success, or false if the variable is already defined
-    /// in this scope.  (Note that a variable can be shadowed in an enclosing
-    /// scope, but it cannot be declared twice in the same scope.)
+    /// Add the given variable declaration to the current (innermost) scope.
+    /// The variable declaration might be a function parameter or a local
+    /// variable.  Returns true for success, or false if the variable is already
+    /// defined in this scope.  (Note that a variable can be shadowed in an
+    /// enclosing scope, but it cannot be declared twice in the same scope.)
     bool Insert( const VarDecl* varDecl )
     {
-        return m_map.insert( MapType::value_type( varDecl->GetName(), varDecl ) ).second;
+        Symbol  name = varDecl->GetName();
+        int32_t top  = getTop( name );
+        if( top >= 0 && m_bindings[top].depth == m_depth )
+            return false;
+        if( name.GetId() >= m_tops.size() )
+            m_tops.resize( name.GetId() + 1, -1 );
+        m_tops[name.GetId()] = static_cast<int32_t>( m_bindings.size() );
+        m_bindings.push_back( Binding{ varDecl, top, m_depth } );
+        return true;
+    }
+
+    /// Enter a nested scope.
+    void Push() { ++m_depth; }
+
+    /// Exit the current scope, discarding its declarations.
+    void Pop()
+    {
+        assert( m_depth > 0 && "Unbalanced scope" );
+        while( !m_bindings.empty() && m_bindings.back().depth == m_depth )
+        {
+            const Binding& binding = m_bindings.back();
+            m_tops[binding.varDecl->GetName().GetId()] = binding.shadowed;
+            m_bindings.pop_back();
+        }
+        --m_depth;
+    }
+
+    /// Exit every scope (e.g. after a type error), leaving the table empty.
+    void Clear()
+    {
+        while( m_depth > 0 )
+            Pop();
     }
 
   private:
-    using MapType = std::unordered_map<std::string, const VarDecl*>;
-    MapType      m_map;
-    const Scope* m_parent;
-};
+    // A binding of a name to a declaration, which links to the binding it shadows (if any).
+    struct Binding
+    {
+        const VarDecl* varDecl;
+        int32_t        shadowed;  // index of the shadowed binding, or -1
+        uint32_t       depth;     // depth of the scope that contains the declaration
+    };
 
+    std::vector<Binding> m_bindings;  // undo log, in order of declaration
+    std::vector<int32_t> m_tops;      // innermost binding of each name, indexed by symbol ID (or -1)
+    uint32_t             m_depth;     // depth of the current scope
 
+    // Get the index of the innermost binding of the given name, or -1 if it is not bound.
+    int32_t getTop( Symbol name ) const { return name.GetId() < m_tops.size() ? m_tops[name.GetId()] : -1; }
+};
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
 #include <llvm/ExecutionEngine/Orc/LLJIT.h>
 #include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
 #include <llvm/IR/DataLayout.h>
@@ -7,6 +10,7 @@
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Target/TargetMachine.h>
 
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -18,8 +22,22 @@ using namespace llvm::orc;
 class SimpleJIT {
 public:
     /// Construct JIT engine, initializing the execution session and layers.
-    SimpleJIT() : m_initialized(false), m_jit(nullptr) {
-        m_initialized = init();
+    /// If an object cache is specified, compiled objects are passed to it, and it is
+    /// consulted before compiling a module.  \see DiskObjectCache
+    /// In lazy mode, each function is optimized and compiled on demand, the first time
+    /// it is called, so functions that never run are never compiled.  The object cache
+    /// is not used in lazy mode, since the modules it compiles are individual functions.
+    /// Code is generated for the host machine.
+    explicit SimpleJIT(ObjectCache* objectCache = nullptr, bool lazy = false)
+        : SimpleJIT(cantFail(JITTargetMachineBuilder::detectHost()), objectCache, lazy) {
+    }
+
+    /// Construct JIT engine that generates code for the specified target machine, which should
+    /// be the same one used by the optimizer.
+    SimpleJIT(JITTargetMachineBuilder target, ObjectCache* objectCache = nullptr, bool lazy = false)
+        : m_initialized(false), m_lazy(lazy), m_objectCache(lazy ? nullptr : objectCache),
+          m_jit(nullptr), m_lazyJit(nullptr) {
+        m_initialized = init(std::move(target));
         if (m_initialized) {
             llvm::sys::DynamicLibrary::LoadLibraryPermanently(nullptr);
         }
@@ -42,6 +60,28 @@ public:
     }
 
 
+    /// Get the underlying ORC JIT, for clients that manage stubs or symbols.  \see TieredJIT
+    LLJIT& getLLJIT() { return *m_jit; }
+
+    /// Returns true if functions are compiled on demand.
+    bool isLazy() const { return m_lazy; }
+
+    /// Set a function that optimizes each module before the JIT compiles it.  In lazy mode,
+    /// the optimizer is applied to each function separately, the first time it is called, on
+    /// the calling thread.  Functions called from several threads are then optimized
+    /// concurrently, so the optimizer must be thread-safe.
+    void setOptimizer(std::function<void(Module&)> optimizer) {
+        if (!m_initialized) {
+            return;
+        }
+
+        m_jit->getIRTransformLayer().setTransform(
+            [optimizer](ThreadSafeModule tsm, MaterializationResponsibility&) -> Expected<ThreadSafeModule> {
+                tsm.withModuleDo([&optimizer](Module& module) { optimizer(module); });
+                return tsm;
+            });
+    }
+
     /// Add the given module to the JIT engine.
     Error addModule(std::unique_ptr<Module> module) {
         if (!m_initialized) {
@@ -51,9 +91,31 @@ public:
         // Create a new context for this module
         auto context = std::make_unique<LLVMContext>();
         ThreadSafeModule tsm(std::move(module), std::move(context));
+        return addModule(std::move(tsm));
+    }
+
+    /// Add the given module, which owns its context, to the JIT engine.  Modules that were
+    /// generated concurrently are added this way, since each has its own context.
+    Error addModule(ThreadSafeModule tsm) {
+        if (!m_initialized) {
+            return make_error<StringError>("JIT not initialized", inconvertibleErrorCode());
+        }
+
+        if (m_lazy) {
+            return m_lazyJit->addLazyIRModule(std::move(tsm));
+        }
         return m_jit->addIRModule(std::move(tsm));
     }
 
+    /// Add a previously compiled object file to the JIT engine.
+    Error addObjectFile(std::unique_ptr<MemoryBuffer> object) {
+        if (!m_initialized) {
+            return make_error<StringError>("JIT not initialized", inconvertibleErrorCode());
+        }
+
+        return m_jit->addObjectFile(std::move(object));
+    }
+
     /// Find the specified symbol in the JIT.
     Expected<ExecutorAddr> findSymbol(const std::string& name) {
         if (!m_initialized) {
@@ -65,20 +127,63 @@ public:
 
 private:
     bool m_initialized;
+    bool m_lazy;
+    ObjectCache* m_objectCache;
     std::unique_ptr<LLJIT> m_jit;
+    LLLazyJIT* m_lazyJit;  // aliases m_jit in lazy mode
 
     // Perform prerequisite initialization.
-    bool init() {
+    bool init(JITTargetMachineBuilder target) {
         // Ensure LLVM target infrastructure is initialized
         if (!initializeLLVM()) {
             return false;
         }
 
-        auto jitOrError = LLJITBuilder().create();
+        if (m_lazy) {
+            return initLazy(std::move(target));
+        }
+
+        LLJITBuilder builder;
+        builder.setJITTargetMachineBuilder(std::move(target));
+        if (m_objectCache) {
+            // Use a compiler that consults the object cache before generating code.
+            ObjectCache* objectCache = m_objectCache;
+            builder.setCompileFunctionCreator(
+                [objectCache](JITTargetMachineBuilder jtmb)
+                    -> Expected<std::unique_ptr<IRCompileLayer::IRCompiler>> {
+                    return std::make_unique<ConcurrentIRCompiler>(std::move(jtmb), objectCache);
+                });
+        }
+
+        auto jitOrError = builder.create();
+        if (!jitOrError) {
+            return false;
+        }
+
+        m_jit = std::move(*jitOrError);
+
+        return true;
+    }
+
+    // Create a lazy JIT, which compiles each function separately when it is first called.
+    // Calls are routed through stubs that trigger compilation of the callee, on whichever
+    // thread makes the call, so compilations can run concurrently.  The default compiler
+    // shares one target machine, so use one that creates a target machine per compilation.
+    bool initLazy(JITTargetMachineBuilder target) {
+        LLLazyJITBuilder builder;
+        builder.setJITTargetMachineBuilder(std::move(target));
+        builder.setCompileFunctionCreator(
+            [](JITTargetMachineBuilder jtmb) -> Expected<std::unique_ptr<IRCompileLayer::IRCompiler>> {
+                return std::make_unique<ConcurrentIRCompiler>(std::move(jtmb));
+            });
+        auto jitOrError = builder.create();
         if (!jitOrError) {
+            consumeError(jitOrError.takeError());
             return false;
         }
 
+        m_lazyJit = jitOrError->get();
+        m_lazyJit->setPartitionFunction(CompileOnDemandLayer::compileRequested);
         m_jit = std::move(*jitOrError);
 
         return true;
@@ -0,0 +1,380 @@
+#include "Simplifier.h"
+#include "Exp.h"
+#include "FuncDef.h"
+#include "Program.h"
+#include "Stmt.h"
+
+#include <climits>
+#include <cstdint>
+
+namespace {
+
+// The result of simplifying an expression: the equivalent expression, whether it is a constant (and
+// if so, its value, with booleans represented as 0 and 1), and whether it is pure, i.e. it calls
+// no user-defined functions, so it can be removed if its value is not needed.  If the expression is
+// a builtin call, it is also recorded, so that nested operations can be combined (e.g. !!b).
+struct Simplified
+{
+    ExpPtr         exp;
+    bool           isConstant;
+    int            value;
+    bool           isPure;
+    const CallExp* call;
+};
+
+// Truncate the result of a 64-bit integer operation to 32 bits, wrapping around on overflow as the
+// generated code does.
+int wrap( int64_t value )
+{
+    return static_cast<int>( static_cast<uint32_t>( value ) );
+}
+
+// The expression simplifier is a visitor, which simplifies the arguments of each call before the
+// call itself.  The simplified expression is returned by the visitor, and the rest of the result is
+// held in a member variable.
+class ExpSimplifier : public ExpVisitor
+{
+  public:
+    ExpSimplifier( Arena* arena, int* numSimplified )
+        : m_arena( arena )
+        , m_numSimplified( numSimplified )
+    {
+    }
+
+    // Helper routine to simplify a subexpression.  The visitor operates on
+    // non-const expressions, so we must const_cast when dispatching.
+    Simplified Simplify( const Exp& exp )
+    {
+        const_cast<Exp&>( exp ).Dispatch( *this );
+        return m_result;
+    }
+
+    // Simplify the arguments of a function call, which are replaced in place.
+    void SimplifyArgs( const CallExp& exp, Simplified* args )
+    {
+        const ArenaArray<ExpPtr>& argExps = exp.GetArgs();
+        for( size_t i = 0; i < argExps.size(); ++i )
+        {
+            Simplified arg = Simplify( *argExps[i] );
+            argExps[i]     = arg.exp;
+            if( args )
+                args[i] = arg;
+        }
+    }
+
+    void* Visit( BoolExp& exp ) override { return setResult( &exp, true, exp.GetValue() ); }
+
+    void* Visit( IntExp& exp ) override { return setResult( &exp, true, exp.GetValue() ); }
+
+    void* Visit( VarExp& exp ) override { return setResult( &exp, false ); }
+
+    // Simplify a function call.  Only calls to builtin functions are simplified (after their
+    // arguments), since a user-defined function might have side effects.
+    void* Visit( CallExp& exp ) override
+    {
+        if( exp.GetIntrinsic() == kIntrinsicNone )
+        {
+            SimplifyArgs( exp, nullptr );
+            return setResult( &exp, false, 0, false /*isPure*/ );
+        }
+
+        // Builtin functions are unary or binary operators.
+        assert( exp.GetArgs().size() <= 2 );
+        Simplified args[2] = {};
+        SimplifyArgs( exp, args );
+        bool isConstant = true;
+        bool isPure     = true;
+        for( size_t i = 0; i < exp.GetArgs().size(); ++i )
+        {
+            isConstant = isConstant && args[i].isConstant;
+            isPure     = isPure && args[i].isPure;
+        }
+
+        if( ( isConstant && fold( exp, args ) ) || simplify( exp, args ) )
+            return m_result.exp;
+        setResult( &exp, false, 0, isPure );
+        m_result.call = &exp;
+        return m_result.exp;
+    }
+
+  private:
+    Arena*     m_arena;
+    int*       m_numSimplified;
+    Simplified m_result;
+
+    // Record the result of simplifying an expression, returning the equivalent expression.
+    void* setResult( ExpPtr exp, bool isConstant, int value = 0, bool isPure = true )
+    {
+        m_result = Simplified{ exp, isConstant, value, isPure, nullptr };
+        return exp;
+    }
+
+    // Replace an expression with the given simplified expression.  Returns true for convenience.
+    bool replace( const Simplified& result )
+    {
+        ++*m_numSimplified;
+        m_result = result;
+        return true;
+    }
+
+    // Replace an expression with a new constant of the given type.  Returns true for convenience.
+    bool replaceWithConstant( Type type, int value )
+    {
+        ExpPtr constant = type == kTypeBool ? static_cast<ExpPtr>( m_arena->New<BoolExp>( value != 0 ) )
+                                            : static_cast<ExpPtr>( m_arena->New<IntExp>( value ) );
+        return replace( Simplified{ constant, true, value, true, nullptr } );
+    }
+
+    // Fold a call to a builtin function whose arguments are constants.  Returns false if the result
+    // is undefined (e.g. division by zero), in which case the call is left for the code generator.
+    bool fold( const CallExp& exp, const Simplified* args )
+    {
+        int64_t a = args[0].value;
+        int64_t b = exp.GetArgs().size() > 1 ? args[1].value : 0;
+        int64_t value;
+        switch( exp.GetIntrinsic() )
+        {
+            case kIntrinsicAdd:
+                value = wrap( a + b );
+                break;
+            case kIntrinsicSub:
+                value = wrap( a - b );
+                break;
+            case kIntrinsicMul:
+                value = wrap( a * b );
+                break;
+            case kIntrinsicDiv:
+            case kIntrinsicMod:
+                if( b == 0 || ( a == INT_MIN && b == -1 ) )
+                    return false;
+                value = exp.GetIntrinsic() == kIntrinsicDiv ? a / b : a % b;
+                break;
+            case kIntrinsicNeg:
+                value = wrap( -a );
+                break;
+            case kIntrinsicEQ:
+                value = a == b;
+                break;
+            case kIntrinsicNE:
+                value = a != b;
+                break;
+            case kIntrinsicLT:
+                value = a < b;
+                break;
+            case kIntrinsicLE:
+                value = a <= b;
+                break;
+            case kIntrinsicGT:
+                value = a > b;
+                break;
+            case kIntrinsicGE:
+                value = a >= b;
+                break;
+            case kIntrinsicNot:
+                value = !a;
+                break;
+            case kIntrinsicAnd:
+                value = a && b;
+                break;
+            case kIntrinsicOr:
+                value = a || b;
+                break;
+            case kIntrinsicIntToBool:
+                value = a != 0;
+                break;
+            case kIntrinsicBoolToInt:
+                value = a;
+                break;
+            case kIntrinsicNone:
+            default:
+                return false;
+        }
+        return replaceWithConstant( exp.GetType(), static_cast<int>( value ) );
+    }
+
+    // Simplify a call to a builtin function using an algebraic identity, e.g. x*1 = x.  Returns
+    // false if no identity applies.  An operand whose value is not needed is removed only if it is
+    // pure (e.g. x*0 is 0 unless x calls a function).
+    bool simplify( const CallExp& exp, const Simplified* args )
+    {
+        const Simplified& a = args[0];
+        const Simplified& b = args[1];
+        switch( exp.GetIntrinsic() )
+        {
+            case kIntrinsicAdd:
+                return simplifyIdentity( a, b, 0 ) || simplifyIdentity( b, a, 0 );
+            case kIntrinsicSub:
+                return simplifyIdentity( b, a, 0 );
+            case kIntrinsicMul:
+                return simplifyIdentity( a, b, 1 ) || simplifyIdentity( b, a, 1 ) ||
+                       simplifyAbsorbing( exp, a, b, 0 ) || simplifyAbsorbing( exp, b, a, 0 );
+            case kIntrinsicDiv:
+                return simplifyIdentity( b, a, 1 );
+            case kIntrinsicAnd:
+                // The second operand of && is not evaluated when the first one is false.
+                if( a.isConstant )
+                    return a.value ? replace( b ) : replaceWithConstant( kTypeBool, 0 );
+                return simplifyIdentity( b, a, 1 ) || simplifyAbsorbing( exp, b, a, 0 );
+            case kIntrinsicOr:
+                // The second operand of || is not evaluated when the first one is true.
+                if( a.isConstant )
+                    return a.value ? replaceWithConstant( kTypeBool, 1 ) : replace( b );
+                return simplifyIdentity( b, a, 0 ) || simplifyAbsorbing( exp, b, a, 1 );
+            case kIntrinsicNot:
+                if( a.call && a.call->GetIntrinsic() == kIntrinsicNot )
+                {
+                    const Exp& operand = *a.call->GetArgs()[0];
+                    return replace( Simplified{ const_cast<Exp*>( &operand ), false, 0, a.isPure, nullptr } );
+                }
+                return false;
+            default:
+                return false;
+        }
+    }
+
+    // If the given constant operand is the identity of an operation, replace the operation with its
+    // other operand.
+    bool simplifyIdentity( const Simplified& constant, const Simplified& other, int identity )
+    {
+        return constant.isConstant && constant.value == identity && replace( other );
+    }
+
+    // If the given constant operand absorbs any other operand (e.g. x*0 = 0), replace the operation
+    // with it, provided the other operand is pure.
+    bool simplifyAbsorbing( const CallExp& exp, const Simplified& constant, const Simplified& other, int absorbing )
+    {
+        return constant.isConstant && constant.value == absorbing && other.isPure &&
+               replaceWithConstant( exp.GetType(), absorbing );
+    }
+};
+
+
+// The statement simplifier simplifies the expressions in each statement and prunes branches with
+// constant conditions.  The simplified statement is held in a member variable.
+class StmtSimplifier : public StmtVisitor
+{
+  public:
+    StmtSimplifier( Arena* arena, int* numSimplified )
+        : m_arena( arena )
+        , m_numSimplified( numSimplified )
+        , m_simplifyExp( arena, numSimplified )
+        , m_emptyStmt( nullptr )
+        , m_result( nullptr )
+        , m_declares( false )
+    {
+    }
+
+    // Helper routine to simplify a sub-statement, returning the equivalent statement.  The visitor
+    // operates on non-const statements, so we must const_cast when dispatching.
+    StmtPtr Simplify( const Stmt& stmt )
+    {
+        m_result   = const_cast<Stmt*>( &stmt );
+        m_declares = false;
+        const_cast<Stmt&>( stmt ).Dispatch( *this );
+        return m_result;
+    }
+
+    // Simplify an expression, returning the equivalent expression.
+    ExpPtr SimplifyExp( const Exp& exp ) { return m_simplifyExp.Simplify( exp ).exp; }
+
+    void Visit( CallStmt& stmt ) override { m_simplifyExp.SimplifyArgs( stmt.GetCallExp(), nullptr ); }
+
+    void Visit( AssignStmt& stmt ) override { stmt.SetRvalue( SimplifyExp( stmt.GetRvalue() ) ); }
+
+    // Simplify a declaration.  A declaration that is not nested in a sequence belongs to the
+    // enclosing scope (e.g. "if (c) int x = 0;" declares x after the "if" statement), so it is noted.
+    void Visit( DeclStmt& stmt ) override
+    {
+        if( stmt.HasInitExp() )
+            stmt.SetInitExp( SimplifyExp( stmt.GetInitExp() ) );
+        m_declares = true;
+    }
+
+    void Visit( ReturnStmt& stmt ) override { stmt.SetExp( SimplifyExp( stmt.GetExp() ) ); }
+
+    // Simplify each statement in a sequence, which is replaced in place.
+    void Visit( SeqStmt& seq ) override
+    {
+        const ArenaArray<StmtPtr>& stmts = seq.Get();
+        for( size_t i = 0; i < stmts.size(); ++i )
+            stmts[i] = Simplify( *stmts[i] );
+        m_result   = &seq;
+        m_declares = false;
+    }
+
+    // Simplify an "if" statement, pruning the branch that is not taken if the condition is constant.
+    // A branch that declares a variable in the enclosing scope is retained, since the declaration
+    // might be referenced later.
+    void Visit( IfStmt& stmt ) override
+    {
+        Simplified cond = m_simplifyExp.Simplify( stmt.GetCondExp() );
+        stmt.SetCondExp( cond.exp );
+        StmtPtr thenStmt     = Simplify( stmt.GetThenStmt() );
+        bool    thenDeclares = m_declares;
+        stmt.SetThenStmt( thenStmt );
+        StmtPtr elseStmt     = nullptr;
+        bool    elseDeclares = false;
+        if( stmt.HasElseStmt() )
+        {
+            elseStmt     = Simplify( stmt.GetElseStmt() );
+            elseDeclares = m_declares;
+            stmt.SetElseStmt( elseStmt );
+        }
+
+        m_result   = &stmt;
+        m_declares = thenDeclares || elseDeclares;
+        if( cond.isConstant && !m_declares )
+        {
+            StmtPtr taken = cond.value ? thenStmt : elseStmt;
+            m_result      = taken ? taken : getEmptyStmt();
+            ++*m_numSimplified;
+        }
+    }
+
+    // Simplify a while loop, which is removed if its condition is false.
+    void Visit( WhileStmt& stmt ) override
+    {
+        Simplified cond = m_simplifyExp.Simplify( stmt.GetCondExp() );
+        stmt.SetCondExp( cond.exp );
+        stmt.SetBodyStmt( Simplify( stmt.GetBodyStmt() ) );
+
+        m_result = &stmt;
+        if( cond.isConstant && !cond.value && !m_declares )
+        {
+            m_result = getEmptyStmt();
+            ++*m_numSimplified;
+        }
+    }
+
+  private:
+    Arena*        m_arena;
+    int*          m_numSimplified;
+    ExpSimplifier m_simplifyExp;
+    StmtPtr       m_emptyStmt;  // allocated on demand
+    StmtPtr       m_result;
+    bool          m_declares;   // true if the result declares a variable in the enclosing scope
+
+    // Get an empty statement, which replaces pruned statements.
+    StmtPtr getEmptyStmt()
+    {
+        if( !m_emptyStmt )
+            m_emptyStmt = m_arena->New<SeqStmt>( ArenaArray<StmtPtr>() );
+        return m_emptyStmt;
+    }
+};
+
+}  // anonymous namespace
+
+
+int Simplify( Program& program )
+{
+    int            numSimplified = 0;
+    StmtSimplifier simplifier( &program.GetArena(), &numSimplified );
+    for( const FuncDefPtr& funcDef : program.GetFunctions() )
+    {
+        // The body is a sequence, which is simplified in place.
+        if( funcDef->HasBody() )
+            simplifier.Simplify( funcDef->GetBody() );
+    }
+    return numSimplified;
+}
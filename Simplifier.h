@@ -0,0 +1,11 @@
+#pragma once
+
+class Program;
+
+/// Simplify the given program, which must have been typechecked, before code is generated for it.
+/// Builtin operations on constants are folded, identities such as x*1, x+0 and !!b are simplified,
+/// and the branches of "if" statements and while loops with constant conditions are pruned.  Calls
+/// to user-defined functions are never removed, and operations whose result is undefined (e.g.
+/// division by zero) are left for the code generator.  New syntax nodes are allocated in the
+/// program's arena.  Returns the number of expressions and statements that were replaced.
+int Simplify( Program& program );
@@ -7,16 +7,13 @@
 class Stmt
 {
   public:
-    /// The destructor is virtual, ensuring that the destructor for a derived
-    /// class will be properly invoked.
-    virtual ~Stmt() {}
-
     /// Dispatch to a visitor.  \see StmtVisitor
     virtual void Dispatch( StmtVisitor& visitor ) = 0;
-};
 
-/// Unique pointer to statement.
-using StmtPtr = std::unique_ptr<Stmt>;
+  protected:
+    /// Statements are owned by an Arena and are never deleted individually.
+    ~Stmt() = default;
+};
 
 
 /// Function call statement, which simply holds a CallExp.
@@ -24,8 +21,8 @@ class CallStmt : public Stmt
 {
   public:
     /// Construct from the given function call expression.
-    CallStmt( CallExpPtr&& callExp )
-        : m_callExp( std::move( callExp ) )
+    CallStmt( CallExpPtr callExp )
+        : m_callExp( callExp )
     {
     }
 
@@ -46,18 +43,21 @@ class AssignStmt : public Stmt
   public:
     /// Construct assignment statement.  The lvalue is a variable, and the
     /// rvalue is an arbitrary expression.
-    AssignStmt( const std::string& varName, ExpPtr&& rvalue )
+    AssignStmt( Symbol varName, ExpPtr rvalue )
         : m_varName( varName )
-        , m_rvalue( std::move( rvalue ) )
+        , m_rvalue( rvalue )
     {
     }
 
     /// Get the variable name (lvalue).
-    const std::string& GetVarName() const { return m_varName; }
+    Symbol GetVarName() const { return m_varName; }
 
     /// Get the rvalue (the right-hand side of the assignment).
     const Exp& GetRvalue() const { return *m_rvalue; }
 
+    /// Replace the rvalue with an equivalent expression (called by the simplifier).
+    void SetRvalue( ExpPtr rvalue ) { m_rvalue = rvalue; }
+
     /// Get the declaration of the assigned variable (null until typechecked).
     const VarDecl* GetVarDecl() const { return m_varDecl; }
 
@@ -69,7 +69,7 @@ class AssignStmt : public Stmt
     void Dispatch( StmtVisitor& visitor ) override { visitor.Visit( *this ); }
 
   private:
-    std::string    m_varName;
+    Symbol         m_varName;
     ExpPtr         m_rvalue;
     const VarDecl* m_varDecl;
 };
@@ -82,17 +82,20 @@ class DeclStmt : public Stmt
   public:
     /// Construct a declaration statement from the specified variable declaration
     /// and optional initializer expression.
-    DeclStmt( VarDeclPtr&& varDecl, ExpPtr&& initExp = ExpPtr() )
-        : m_varDecl( std::move( varDecl ) )
-        , m_initExp( std::move( initExp ) )
+    DeclStmt( VarDeclPtr varDecl, ExpPtr initExp = nullptr )
+        : m_varDecl( varDecl )
+        , m_initExp( initExp )
     {
     }
 
     /// Get pointer to variable declaration, which is stored at use sites by the typechecker.
-    const VarDecl* GetVarDecl() const { return m_varDecl.get(); }
+    const VarDecl* GetVarDecl() const { return m_varDecl; }
+
+    /// Get pointer to variable declaration, which the typechecker modifies (\see VarDecl::SetSlot).
+    VarDecl* GetVarDecl() { return m_varDecl; }
 
     /// Check whether this declaration has an initializer expression.
-    bool HasInitExp() const { return bool( m_initExp ); }
+    bool HasInitExp() const { return m_initExp != nullptr; }
 
     /// Get the initializer expression.  Check HasInitExp() before calling.
     const Exp& GetInitExp() const
@@ -101,6 +104,9 @@ class DeclStmt : public Stmt
         return *m_initExp;
     }
 
+    /// Replace the initializer expression with an equivalent expression (called by the simplifier).
+    void SetInitExp( ExpPtr initExp ) { m_initExp = initExp; }
+
     /// Dispatch to a visitor.
     void Dispatch( StmtVisitor& visitor ) override { visitor.Visit( *this ); }
 
@@ -116,14 +122,17 @@ class ReturnStmt : public Stmt
   public:
     /// Construct return statement with the given return value expression.
     /// (Note that void functions are not permitted, so the return value is required.)
-    ReturnStmt( ExpPtr&& exp )
-        : m_exp( std::move( exp ) )
+    ReturnStmt( ExpPtr exp )
+        : m_exp( exp )
     {
     }
 
     /// Get the return value expression.
     const Exp& GetExp() const { return *m_exp; }
 
+    /// Replace the return value expression with an equivalent expression (called by the simplifier).
+    void SetExp( ExpPtr exp ) { m_exp = exp; }
+
     /// Dispatch to a visitor.
     void Dispatch( StmtVisitor& visitor ) override { visitor.Visit( *this ); }
 
@@ -136,25 +145,22 @@ class ReturnStmt : public Stmt
 class SeqStmt : public Stmt
 {
   public:
-    /// Construct sequence of statements from a vector of unique pointers.
-    SeqStmt( std::vector<StmtPtr>&& stmts )
-        : m_stmts( std::move( stmts ) )
+    /// Construct sequence of statements, which are allocated in the same Arena as the sequence.
+    SeqStmt( ArenaArray<StmtPtr> stmts )
+        : m_stmts( stmts )
     {
     }
 
     /// Get the sequence of statements.
-    const std::vector<StmtPtr>& Get() const { return m_stmts; }
+    const ArenaArray<StmtPtr>& Get() const { return m_stmts; }
 
     /// Dispatch to a visitor.
     void Dispatch( StmtVisitor& visitor ) override { visitor.Visit( *this ); }
 
   private:
-    std::vector<StmtPtr> m_stmts;
+    ArenaArray<StmtPtr> m_stmts;
 };
 
-/// Unique pointer to a sequence of statements.
-using SeqStmtPtr = std::unique_ptr<SeqStmt>;
-
 
 /// If statement syntax.
 class IfStmt : public Stmt
@@ -162,10 +168,10 @@ class IfStmt : public Stmt
   public:
     /// Construct "if" statement with conditional expression, "then" statement
     /// (which might be a sequence), and an optional "else" statement.
-    IfStmt( ExpPtr condExp, StmtPtr thenStmt, StmtPtr elseStmt = StmtPtr() )
-        : m_condExp( std::move( condExp ) )
-        , m_thenStmt( std::move( thenStmt ) )
-        , m_elseStmt( std::move( elseStmt ) )
+    IfStmt( ExpPtr condExp, StmtPtr thenStmt, StmtPtr elseStmt = nullptr )
+        : m_condExp( condExp )
+        , m_thenStmt( thenStmt )
+        , m_elseStmt( elseStmt )
     {
     }
 
@@ -176,7 +182,7 @@ class IfStmt : public Stmt
     const Stmt& GetThenStmt() const { return *m_thenStmt; }
 
     /// Check whether this "if" statement has an "else" statement.
-    bool HasElseStmt() const { return bool( m_elseStmt ); }
+    bool HasElseStmt() const { return m_elseStmt != nullptr; }
 
     /// Get the "else" statement.
     const Stmt& GetElseStmt() const
@@ -185,6 +191,15 @@ class IfStmt : public Stmt
         return *m_elseStmt;
     }
 
+    /// Replace the conditional expression with an equivalent expression (called by the simplifier).
+    void SetCondExp( ExpPtr condExp ) { m_condExp = condExp; }
+
+    /// Replace the "then" statement with an equivalent statement (called by the simplifier).
+    void SetThenStmt( StmtPtr thenStmt ) { m_thenStmt = thenStmt; }
+
+    /// Replace the "else" statement (if any) with an equivalent statement (called by the simplifier).
+    void SetElseStmt( StmtPtr elseStmt ) { m_elseStmt = elseStmt; }
+
     /// Dispatch to a visitor.
     void Dispatch( StmtVisitor& visitor ) override { visitor.Visit( *this ); }
 
@@ -202,8 +217,8 @@ class WhileStmt : public Stmt
     /// Construct while statement from a conditional expression and the loop body
     /// statement (which might be a sequence).
     WhileStmt( ExpPtr condExp, StmtPtr bodyStmt )
-        : m_condExp( std::move( condExp ) )
-        , m_bodyStmt( std::move( bodyStmt ) )
+        : m_condExp( condExp )
+        , m_bodyStmt( bodyStmt )
     {
     }
 
@@ -213,6 +228,12 @@ class WhileStmt : public Stmt
     /// Get the loop body statement (which might be a sequence).
     const Stmt& GetBodyStmt() const { return *m_bodyStmt; }
 
+    /// Replace the conditional expression with an equivalent expression (called by the simplifier).
+    void SetCondExp( ExpPtr condExp ) { m_condExp = condExp; }
+
+    /// Replace the loop body with an equivalent statement (called by the simplifier).
+    void SetBodyStmt( StmtPtr bodyStmt ) { m_bodyStmt = bodyStmt; }
+
     /// Dispatch to a visitor.
     void Dispatch( StmtVisitor& visitor ) override { visitor.Visit( *this ); }
     
@@ -0,0 +1,82 @@
+#include "Symbol.h"
+
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// The symbol table maps strings to symbol IDs and vice versa.  Strings are
+// stored in a deque, which never relocates its elements, so the string_view
+// keys in the index remain valid as the table grows.  Lookups take a shared
+// lock, so concurrent lexers only serialize when they intern a new string.
+class SymbolTable
+{
+  public:
+    SymbolTable() { insert( std::string_view() ); }  // ID zero is the empty symbol.
+
+    // Get the ID of the given string, adding it to the table if necessary.
+    uint32_t Intern( std::string_view str )
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock( m_mutex );
+            auto it = m_index.find( str );
+            if( it != m_index.end() )
+                return it->second;
+        }
+        std::unique_lock<std::shared_mutex> lock( m_mutex );
+        auto it = m_index.find( str );  // Another thread might have inserted it.
+        return it != m_index.end() ? it->second : insert( str );
+    }
+
+    // Get the string with the given ID.
+    const std::string& Get( uint32_t id )
+    {
+        std::shared_lock<std::shared_mutex> lock( m_mutex );
+        return *m_strings[id];
+    }
+
+  private:
+    std::shared_mutex                              m_mutex;
+    std::deque<std::string>                        m_storage;
+    std::vector<const std::string*>                m_strings;  // indexed by ID
+    std::unordered_map<std::string_view, uint32_t> m_index;
+
+    // Add a string to the table (with the lock held), returning its ID.
+    uint32_t insert( std::string_view str )
+    {
+        uint32_t id = static_cast<uint32_t>( m_strings.size() );
+        m_storage.emplace_back( str );
+        m_strings.push_back( &m_storage.back() );
+        m_index.emplace( m_storage.back(), id );
+        return id;
+    }
+};
+
+// Get the global symbol table, constructing it on first use.
+SymbolTable& getSymbolTable()
+{
+    static SymbolTable table;
+    return table;
+}
+
+} // anonymous namespace
+
+Symbol Symbol::Intern( const char* begin, const char* end )
+{
+    return Symbol( getSymbolTable().Intern( std::string_view( begin, end - begin ) ) );
+}
+
+const std::string& Symbol::ToString() const
+{
+    return getSymbolTable().Get( m_id );
+}
+
+std::ostream& operator<<( std::ostream& out, Symbol symbol )
+{
+    return out << symbol.ToString();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+
+/// A Symbol is an interned identifier or operator name.  Each distinct string
+/// is stored once in a global symbol table and identified by a small integer,
+/// so symbols are cheap to copy, and comparing or hashing them never touches
+/// the characters.  Symbol IDs are stable for the lifetime of the process.
+/// Interning is thread safe.
+class Symbol
+{
+  public:
+    /// Construct the empty symbol.
+    Symbol()
+        : m_id( 0 )
+    {
+    }
+
+    /// Intern the given string, returning its symbol.
+    static Symbol Intern( const char* begin, const char* end );
+
+    /// Intern the given string, returning its symbol.
+    static Symbol Intern( const std::string& str ) { return Intern( str.data(), str.data() + str.size() ); }
+
+    /// Get the symbol's ID, which is a dense index into the symbol table.
+    uint32_t GetId() const { return m_id; }
+
+    /// Get the symbol with the given ID, which must have been obtained from GetId().
+    static Symbol FromId( uint32_t id ) { return Symbol( id ); }
+
+    /// Get the symbol's text.
+    const std::string& ToString() const;
+
+    bool operator==( Symbol other ) const { return m_id == other.m_id; }
+
+    bool operator!=( Symbol other ) const { return m_id != other.m_id; }
+
+    /// Symbols are ordered by ID (not alphabetically), which allows them to be used in ordered maps.
+    bool operator<( Symbol other ) const { return m_id < other.m_id; }
+
+  private:
+    explicit Symbol( uint32_t id )
+        : m_id( id )
+    {
+    }
+
+    uint32_t m_id;
+};
+
+/// Output a symbol's text.
+std::ostream& operator<<( std::ostream& out, Symbol symbol );
+
+namespace std {
+/// Symbols are hashed by ID.
+template <>
+struct hash<Symbol>
+{
+    size_t operator()( Symbol symbol ) const { return symbol.GetId(); }
+};
+}  // namespace std
@@ -23,12 +23,14 @@ class FuncDef;
 class Program;
 class VarDecl;
 
-using ExpPtr     = std::unique_ptr<Exp>;
-using CallExpPtr = std::unique_ptr<CallExp>;
-using FuncDefPtr = std::unique_ptr<FuncDef>;
+// Syntax nodes are allocated in an Arena owned by the Program (\see Arena),
+// so they are referenced by plain pointers.  A Program is heap allocated.
+using ExpPtr     = Exp*;
+using CallExpPtr = CallExp*;
+using FuncDefPtr = FuncDef*;
 using ProgramPtr = std::unique_ptr<Program>;
-using SeqStmtPtr = std::unique_ptr<SeqStmt>;
-using StmtPtr    = std::unique_ptr<Stmt>;
-using VarDeclPtr = std::unique_ptr<VarDecl>;
+using SeqStmtPtr = SeqStmt*;
+using StmtPtr    = Stmt*;
+using VarDeclPtr = VarDecl*;
 
 
@@ -0,0 +1,291 @@
+#pragma once
+
+#include "SimpleJIT.h"
+
+#include <llvm/ExecutionEngine/Orc/IndirectionUtils.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Module.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Tiered execution on top of SimpleJIT.  Modules are compiled quickly (typically at -O0), with a
+/// counter in each function.  When a function has been called often enough, it is recompiled by
+/// a background thread with the given optimizer, and swapped in.
+///
+/// Every call to a function goes through an indirect stub with the function's original name.
+/// Initially the stub points to the "name.tier0" body; after recompilation it points to the
+/// "name.tier2" body.  Code that is already running in the old body is unaffected.
+class TieredJIT {
+public:
+    /// Number of calls after which a function is recompiled, unless otherwise specified.
+    static const uint32_t kDefaultThreshold = 1000;
+
+    /// Construct a tiered JIT that adds code to the given (eager) JIT engine.  Hot functions are
+    /// optimized with the given function before they are recompiled.
+    TieredJIT(SimpleJIT& jit, std::function<void(Module&)> optimizer,
+              uint32_t threshold = kDefaultThreshold)
+        : m_jit(jit), m_optimizer(std::move(optimizer)), m_threshold(threshold), m_stopping(false) {
+        LLJIT& lljit = m_jit.getLLJIT();
+        m_stubs = createLocalIndirectStubsManagerBuilder(lljit.getTargetTriple())();
+
+        // The instrumented code calls back into the tiered JIT to request recompilation.
+        SymbolMap symbols;
+        symbols[lljit.mangleAndIntern(kTierUpName)] =
+            ExecutorSymbolDef(ExecutorAddr::fromPtr(&tierUpCallback), JITSymbolFlags::Exported);
+        cantFail(lljit.getMainJITDylib().define(absoluteSymbols(std::move(symbols))));
+
+        m_worker = std::thread([this]() { recompileHotFunctions(); });
+    }
+
+    /// Stop recompiling functions.  A function that is being recompiled is finished first.
+    ~TieredJIT() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_ready.notify_one();
+        m_worker.join();
+    }
+
+    TieredJIT(const TieredJIT&) = delete;
+    TieredJIT& operator=(const TieredJIT&) = delete;
+
+    /// Add the given (unoptimized) module to the JIT engine.  An unmodified copy is retained, from
+    /// which hot functions are recompiled.  The code cannot be executed until findSymbol has
+    /// been called, since functions in one module might call functions in modules added later.
+    Error addModule(ThreadSafeModule tsm) {
+        std::vector<std::string> names;
+        tsm.withModuleDo([&](Module& module) {
+            for (Function& function : module) {
+                if (!function.isDeclaration()) {
+                    names.push_back(function.getName().str());
+                }
+            }
+        });
+
+        // Register the functions, which assigns their indices.
+        size_t firstIndex;
+        {
+            ThreadSafeModule original = cloneToNewContext(tsm);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            size_t moduleIndex = m_originals.size();
+            m_originals.push_back(std::move(original));
+            firstIndex = m_functions.size();
+            for (const std::string& name : names) {
+                m_unlinked.push_back(m_functions.size());
+                m_functions.push_back(FunctionInfo{name, moduleIndex, false});
+            }
+        }
+        tsm.withModuleDo([&](Module& module) { instrument(module, names, firstIndex); });
+
+        // Define a stub for each function.  The stubs are pointed at the instrumented bodies once
+        // they are compiled.  \see linkStubs
+        LLJIT& lljit = m_jit.getLLJIT();
+        SymbolMap stubSymbols;
+        for (const std::string& name : names) {
+            if (Error error = m_stubs->createStub(name, ExecutorAddr(), JITSymbolFlags::Exported)) {
+                return error;
+            }
+            ExecutorSymbolDef stub = m_stubs->findStub(name, false /*exportedStubsOnly*/);
+            stubSymbols[lljit.mangleAndIntern(name)] =
+                ExecutorSymbolDef(stub.getAddress(), JITSymbolFlags::Exported | JITSymbolFlags::Callable);
+        }
+        if (Error error = lljit.getMainJITDylib().define(absoluteSymbols(std::move(stubSymbols)))) {
+            return error;
+        }
+
+        return m_jit.addModule(std::move(tsm));
+    }
+
+    /// Find the specified symbol in the JIT.  Function symbols resolve to stubs, which are first
+    /// pointed at the code of any modules that have been added.
+    Expected<ExecutorAddr> findSymbol(const std::string& name) {
+        if (Error error = linkStubs()) {
+            return std::move(error);
+        }
+        return m_jit.findSymbol(name);
+    }
+
+    /// Get the number of functions that have been recompiled.
+    size_t getNumRecompiled() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_numRecompiled;
+    }
+
+private:
+    // Name of the function called by instrumented code when a counter reaches the threshold.
+    static constexpr const char* kTierUpName = "__weekend_tierup";
+
+    struct FunctionInfo {
+        std::string name;         // Name of the stub; bodies are suffixed with ".tier0" or ".tier2"
+        size_t      moduleIndex;  // Index of the original module that defines the function
+        bool        requested;    // True if recompilation has been requested
+    };
+
+    SimpleJIT& m_jit;
+    std::function<void(Module&)> m_optimizer;
+    uint32_t m_threshold;
+    std::unique_ptr<IndirectStubsManager> m_stubs;
+
+    // The following are guarded by the mutex.
+    mutable std::mutex m_mutex;
+    std::condition_variable m_ready;
+    std::deque<ThreadSafeModule> m_originals;  // a deque, so references remain valid as it grows
+    std::vector<FunctionInfo> m_functions;
+    std::vector<size_t> m_unlinked;  // Functions whose stubs are not yet initialized
+    std::deque<size_t> m_hot;        // Functions awaiting recompilation
+    size_t m_numRecompiled = 0;
+    bool m_stopping;
+
+    std::thread m_worker;
+
+    // Called by instrumented code when a function becomes hot.
+    static void tierUpCallback(TieredJIT* tieredJit, int32_t index) {
+        tieredJit->requestRecompile(static_cast<size_t>(index));
+    }
+
+    // Queue the specified function for recompilation, unless it has been queued already.
+    void requestRecompile(size_t index) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_functions[index].requested) {
+                return;
+            }
+            m_functions[index].requested = true;
+            m_hot.push_back(index);
+        }
+        m_ready.notify_one();
+    }
+
+    // Rename the body of each of the named functions, adding a declaration with the original name
+    // that will resolve to the function's stub, and count calls to the body.  The functions are
+    // assigned consecutive indices, starting with the given one.
+    void instrument(Module& module, const std::vector<std::string>& names, size_t firstIndex) {
+        LLVMContext& context = module.getContext();
+        IRBuilder<> builder(context);
+        PointerType* ptrType = PointerType::get(context, 0);
+        FunctionCallee tierUp =
+            module.getOrInsertFunction(kTierUpName, builder.getVoidTy(), ptrType, builder.getInt32Ty());
+        Constant* self = ConstantExpr::getIntToPtr(
+            builder.getInt64(reinterpret_cast<uintptr_t>(this)), ptrType);
+
+        for (size_t i = 0; i < names.size(); ++i) {
+            const std::string& name = names[i];
+            int32_t index = static_cast<int32_t>(firstIndex + i);
+            Function* body = module.getFunction(name);
+
+            // Route calls through a declaration with the original name.
+            body->setName(name + ".tier0");
+            body->setLinkage(GlobalValue::ExternalLinkage);
+            Function* stub = Function::Create(body->getFunctionType(), GlobalValue::ExternalLinkage, name, module);
+            body->replaceAllUsesWith(stub);
+
+            // Increment the call counter on entry, requesting recompilation when it reaches the
+            // threshold.  The increment is atomic, since several threads might call the function.
+            GlobalVariable* counter =
+                new GlobalVariable(module, builder.getInt32Ty(), false /*isConstant*/, GlobalValue::InternalLinkage,
+                                   builder.getInt32(0), name + ".calls");
+            BasicBlock* oldEntry = &body->getEntryBlock();
+            BasicBlock* countBlock = BasicBlock::Create(context, "count", body, oldEntry);
+            BasicBlock* tierUpBlock = BasicBlock::Create(context, "tierup", body, oldEntry);
+            builder.SetInsertPoint(countBlock);
+            Value* count = builder.CreateAtomicRMW(AtomicRMWInst::Add, counter, builder.getInt32(1), MaybeAlign(4),
+                                                   AtomicOrdering::Monotonic);
+            Value* isHot = builder.CreateICmpEQ(count, builder.getInt32(m_threshold - 1));
+            builder.CreateCondBr(isHot, tierUpBlock, oldEntry);
+            builder.SetInsertPoint(tierUpBlock);
+            builder.CreateCall(tierUp, {self, builder.getInt32(index)});
+            builder.CreateBr(oldEntry);
+
+            // Keep the allocas in the entry block, so they remain static.
+            for (Instruction& inst : make_early_inc_range(*oldEntry)) {
+                if (isa<AllocaInst>(inst)) {
+                    inst.moveBefore(countBlock->getTerminator());
+                }
+            }
+        }
+    }
+
+    // Point the stubs of newly added functions at their instrumented bodies, which compiles them.
+    Error linkStubs() {
+        std::vector<std::string> names;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (size_t index : m_unlinked) {
+                names.push_back(m_functions[index].name);
+            }
+            m_unlinked.clear();
+        }
+        for (const std::string& name : names) {
+            if (Error error = updateStub(name, name + ".tier0")) {
+                return error;
+            }
+        }
+        return Error::success();
+    }
+
+    // Point the stub with the given name at the specified body.
+    Error updateStub(const std::string& name, const std::string& bodyName) {
+        Expected<ExecutorAddr> body = m_jit.findSymbol(bodyName);
+        if (!body) {
+            return body.takeError();
+        }
+        return m_stubs->updatePointer(name, *body);
+    }
+
+    // Background thread that recompiles hot functions until the tiered JIT is destroyed.
+    void recompileHotFunctions() {
+        while (true) {
+            FunctionInfo function;
+            const ThreadSafeModule* original;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_ready.wait(lock, [this]() { return m_stopping || !m_hot.empty(); });
+                if (m_stopping) {
+                    return;
+                }
+                function = m_functions[m_hot.front()];
+                original = &m_originals[function.moduleIndex];
+                m_hot.pop_front();
+            }
+
+            if (Error error = recompile(function.name, *original)) {
+                errs() << "Warning: unable to recompile " << function.name << ": " << toString(std::move(error))
+                       << "\n";
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_numRecompiled;
+        }
+    }
+
+    // Recompile the named function from the given original module, and swap it into its stub.
+    // Other functions are declared, so calls to them go through their stubs, but recursive calls
+    // are direct.
+    Error recompile(const std::string& name, const ThreadSafeModule& original) {
+        ThreadSafeModule tsm = cloneToNewContext(
+            original, [&name](const GlobalValue& value) { return value.getName() == name; });
+        tsm.withModuleDo([&](Module& module) {
+            Function* function = module.getFunction(name);
+            function->setName(name + ".tier2");
+            function->setLinkage(GlobalValue::ExternalLinkage);
+            m_optimizer(module);
+        });
+
+        if (Error error = m_jit.addModule(std::move(tsm))) {
+            return error;
+        }
+        return updateStub(name, name + ".tier2");
+    }
+};
@@ -1,5 +1,6 @@
 #include "Token.h"
 #include <string>
+#include <vector>
 
 std::string Token::ToString() const
 {
@@ -11,7 +12,7 @@ std::string Token::ToString() const
             stream << GetNum();
             return stream.str();
         }
-        case kTokenId:        return GetId();
+        case kTokenId:        return GetId().ToString();
         case kTokenBool:      return "bool";
         case kTokenTrue:      return "true";
         case kTokenFalse:     return "false";
@@ -47,3 +48,25 @@ std::string Token::ToString() const
     assert(false && "Unhandled token kind");
     return "";
 }
+
+Symbol Token::ToSymbol() const
+{
+    switch( GetTag() )
+    {
+        case kTokenNum:
+            return Symbol::Intern( ToString() );
+        case kTokenId:
+            return GetId();
+        default:
+        {
+            // Intern the text of every other token on first use.
+            static const std::vector<Symbol> symbols = [] {
+                std::vector<Symbol> result( kTokenEOF + 1 );
+                for( int tag = kTokenBool; tag <= kTokenEOF; ++tag )
+                    result[tag] = Symbol::Intern( Token( TokenTag( tag ) ).ToString() );
+                return result;
+            }();
+            return symbols[GetTag()];
+        }
+    }
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Symbol.h"
 #include <cassert>
 #include <iosfwd>
 #include <sstream>
@@ -52,6 +53,7 @@ enum TokenTag
 
 /// The lexer converts sequences of characters into tokens.  A token has a tag
 /// (e.g. integer vs. id) and a value (e.g integer value or identifier name).
+/// Identifiers are interned by the lexer, so tokens are cheap to copy.
 class Token
 {
   public:
@@ -63,7 +65,7 @@ class Token
     }
 
     /// Construct an identifier token.
-    explicit Token( const std::string& id )
+    explicit Token( Symbol id )
         : m_tag( kTokenId )
         , m_id( id )
     {
@@ -87,7 +89,7 @@ class Token
     }
 
     /// Get identifier.
-    const std::string& GetId() const
+    Symbol GetId() const
     {
         assert( GetTag() == kTokenId && "Expected identifier token" );
         return m_id;
@@ -96,6 +98,10 @@ class Token
     /// Get token text, e.g. operator name.
     std::string ToString() const;
 
+    /// Get token text as a symbol.  Operator and keyword symbols are interned
+    /// once, so this does not allocate.
+    Symbol ToSymbol() const;
+
     /// Equality considers token value for numeric and identifier tokens.
     bool operator==( const Token& other )
     {
@@ -141,9 +147,9 @@ class Token
     }
 
   private:
-    TokenTag    m_tag;  // Tag of token, e.g. int, id, keyword.
-    int         m_int;  // Integer value, if tag is kTokenNum.
-    std::string m_id;   // Identifier value, if tag is kTokenId.
+    TokenTag m_tag;  // Tag of token, e.g. int, id, keyword.
+    int      m_int;  // Integer value, if tag is kTokenNum.
+    Symbol   m_id;   // Identifier value, if tag is kTokenId.
 };
 
 
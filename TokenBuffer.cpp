@@ -0,0 +1,44 @@
+#include "TokenBuffer.h"
+#include "Lexer.h"
+
+#include <algorithm>
+
+TokenBuffer::TokenBuffer( const char* source )
+    : TokenBuffer( source, source, nullptr )
+{
+}
+
+// A null end denotes the end of the source.  The token that follows the range is lexed (and
+// discarded), since the lexer cannot be told where to stop.
+TokenBuffer::TokenBuffer( const char* source, const char* begin, const char* end )
+    : m_source( source )
+{
+    const char* cursor = begin;
+    const char* tokenBegin;
+    for( ;; )
+    {
+        Token token( Lexer( cursor, tokenBegin ) );
+        if( end && tokenBegin >= end )
+        {
+            token      = kTokenEOF;
+            tokenBegin = end;
+        }
+        TokenTag tag = token.GetTag();
+        m_tags.push_back( static_cast<uint8_t>( tag ) );
+        m_offsets.push_back( static_cast<uint32_t>( tokenBegin - source ) );
+        if( tag == kTokenNum )
+            m_values.push_back( static_cast<uint32_t>( token.GetNum() ) );
+        else if( tag == kTokenId )
+            m_values.push_back( token.GetId().GetId() );
+        else
+            m_values.push_back( 0 );
+        if( tag == kTokenEOF )
+            break;
+    }
+}
+
+int TokenBuffer::GetLine( size_t index ) const
+{
+    index = std::min( index, m_offsets.size() - 1 );
+    return 1 + static_cast<int>( std::count( m_source, m_source + m_offsets[index], '\n' ) );
+}
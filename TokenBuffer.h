@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Token.h"
+
+#include <cstdint>
+#include <vector>
+
+/// A TokenBuffer holds every token of a source string, which is lexed once, up front, when the
+/// buffer is constructed.  The tokens are stored in parallel arrays (tags, source offsets, and
+/// values), which are compact and read sequentially by the parser.  \see TokenStream
+class TokenBuffer
+{
+  public:
+    /// Lex the given null-terminated source code.  The source must outlive the buffer.
+    explicit TokenBuffer( const char* source );
+
+    /// Lex the tokens of the given source that start within [begin, end), which must not split a
+    /// token.  Offsets (and line numbers) remain relative to the start of the source.
+    TokenBuffer( const char* source, const char* begin, const char* end );
+
+    TokenBuffer( const TokenBuffer& )            = delete;
+    TokenBuffer& operator=( const TokenBuffer& ) = delete;
+
+    /// Get the number of tokens, including the final kTokenEOF.
+    size_t GetNumTokens() const { return m_tags.size(); }
+
+    /// Get the token with the given index.  Indices past the end yield kTokenEOF.
+    Token GetToken( size_t index ) const
+    {
+        if( index >= m_tags.size() )
+            return kTokenEOF;
+        TokenTag tag = static_cast<TokenTag>( m_tags[index] );
+        if( tag == kTokenNum )
+            return Token( static_cast<int>( m_values[index] ) );
+        if( tag == kTokenId )
+            return Token( Symbol::FromId( m_values[index] ) );
+        return tag;
+    }
+
+    /// Get the offset in the source of the first character of the given token.
+    uint32_t GetOffset( size_t index ) const { return m_offsets[index]; }
+
+    /// Get the (one-based) line number of the given token, which is computed by counting the
+    /// newlines that precede it, so it is intended only for error messages.
+    int GetLine( size_t index ) const;
+
+  private:
+    const char*           m_source;
+    std::vector<uint8_t>  m_tags;     // TokenTag
+    std::vector<uint32_t> m_offsets;  // offset of the token in the source (modulo 4GB)
+    std::vector<uint32_t> m_values;   // integer value (kTokenNum) or symbol ID (kTokenId)
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Lexer.h"
+#include "TokenBuffer.h"
 
 /// The Lexer returns a single token.  This class wraps the Lexer to provide a
 /// stream-like interface to the Parser.  A single token of lookahead is
@@ -8,6 +9,9 @@
 /// increment operator.  For example, a token is typically consumed via
 /// "Token token(*tokens++);"  (Note that the dereference operator has higher
 /// precedence than the increment operator.)
+///
+/// The tokens are either lexed on demand, from a string or a file, or they are
+/// read from a TokenBuffer that has been lexed in advance.
 class TokenStream
 {
   public:
@@ -15,32 +19,93 @@ class TokenStream
     /// terminated.
     TokenStream( const char* source )
         : m_source( source )
+        , m_input( nullptr )
+        , m_buffer( nullptr )
+        , m_index( 0 )
         , m_token( kTokenEOF )
+        , m_numTokens( 0 )
     {
         ++*this;  // Lex the first token
     }
 
+    /// Construct token stream that lexes the given input as tokens are requested
+    /// (\see LexerInput).  The input must outlive the token stream.
+    TokenStream( LexerInput* input )
+        : m_source( nullptr )
+        , m_input( input )
+        , m_buffer( nullptr )
+        , m_index( 0 )
+        , m_token( kTokenEOF )
+        , m_numTokens( 0 )
+    {
+        ++*this;  // Lex the first token
+    }
+
+    /// Construct token stream that reads the tokens in the given buffer, which
+    /// must outlive the token stream.
+    TokenStream( const TokenBuffer* buffer )
+        : m_source( nullptr )
+        , m_input( nullptr )
+        , m_buffer( buffer )
+        , m_index( 0 )
+        , m_token( kTokenEOF )
+        , m_numTokens( 0 )
+    {
+        ++*this;  // Read the first token
+    }
+
     /// Inspect the next token, without advancing the token stream.
     Token operator*() { return m_token; }
 
     /// Advance the token stream, calling the Lexer to obtain the next token.
     TokenStream& operator++()
     {
-        m_token = Lexer( m_source );
+        if( m_buffer )
+            m_token = m_buffer->GetToken( m_numTokens );
+        else
+            m_token = m_input ? Lexer( *m_input ) : Lexer( m_source );
+        m_index = m_numTokens++;
         return *this;
     }
 
-    /// Postfix increment operator. 
-    TokenStream operator++( int )
+    /// The result of the postfix increment operator, which holds the token that
+    /// was consumed.
+    class Consumed
     {
-        TokenStream before( *this );
+      public:
+        explicit Consumed( const Token& token )
+            : m_token( token )
+        {
+        }
+
+        /// Get the consumed token.
+        Token operator*() const { return m_token; }
+
+      private:
+        Token m_token;
+    };
+
+    /// Postfix increment operator.  Only the consumed token is retained, rather
+    /// than a copy of the stream.
+    Consumed operator++( int )
+    {
+        Consumed before( m_token );
         this->operator++();
         return before;
     }
 
-  private:
-    const char* m_source;
-    Token       m_token;
-};
+    /// Get the number of tokens lexed so far, including the lookahead token.
+    size_t GetNumTokens() const { return m_numTokens; }
 
+    /// Get the line number of the most recently consumed token (for error
+    /// messages), or zero if it is unknown because the tokens are not buffered.
+    int GetLine() const { return m_buffer ? m_buffer->GetLine( m_index > 0 ? m_index - 1 : 0 ) : 0; }
 
+  private:
+    const char*        m_source;  // null unless the source is a string
+    LexerInput*        m_input;   // null unless the source is a file
+    const TokenBuffer* m_buffer;  // null unless the tokens are buffered
+    size_t             m_index;   // index of the lookahead token
+    Token              m_token;
+    size_t             m_numTokens;
+};
@@ -1,20 +1,23 @@
 #include "Typechecker.h"
 #include "Exp.h"
 #include "FuncDef.h"
+#include "OverloadIndex.h"
 #include "Program.h"
 #include "Scope.h"
 #include "Stmt.h"
 #include "VarDecl.h"
 
+#include <llvm/Support/ThreadPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <iostream>
+#include <mutex>
 #include <string>
-#include <map>
 
 namespace {
     
-// The function table is a multimap, mapping function names to overloaded definitions.
-using FuncTable = std::multimap<std::string, const FuncDef*>;
-
 // Exceptions are used internally by the typechecker, but they do not
 // propagate beyond the top-level typechecking routine.
 class TypeError : public std::runtime_error
@@ -27,8 +30,8 @@ class TypeError : public std::runtime_error
 };
 
 // The expression typechecker is a visitor.  It holds a Scope, which maps
-// variable names to their declarations, and a function table, which maps
-// function names to definitions.  The typechecker decorates each expression
+// variable names to their declarations, and a function index, which maps
+// function names and parameter types to definitions.  The typechecker decorates each expression
 // with its type, and it resolves lexical scoping, linking variable references
 // and function calls to the corresponding definitions.  This allows
 // subsequent passes (e.g. Codegen) to operate without any knowledge of
@@ -36,10 +39,10 @@ class TypeError : public std::runtime_error
 class ExpTypechecker : public ExpVisitor
 {
   public:
-    // Construct typecheck from scope and function table.
-    ExpTypechecker( const Scope& scope, const FuncTable& funcTable )
+    // Construct typecheck from scope and function index.
+    ExpTypechecker( const Scope& scope, const OverloadIndex& funcIndex )
         : m_scope( scope )
-        , m_funcTable( funcTable )
+        , m_funcIndex( funcIndex )
     {
     }
 
@@ -76,7 +79,7 @@ class ExpTypechecker : public ExpVisitor
             exp.SetVarDecl( decl );
         }
         else
-            throw TypeError( std::string( "Undefined variable: " ) + exp.GetName() );
+            throw TypeError( "Undefined variable: " + exp.GetName().ToString() );
         return nullptr;
     }
 
@@ -84,69 +87,47 @@ class ExpTypechecker : public ExpVisitor
     void* Visit( CallExp& exp ) override
     {
         // Typecheck the arguments.
-        const std::vector<ExpPtr>& args = exp.GetArgs();
+        const ArenaArray<ExpPtr>& args = exp.GetArgs();
         for( const ExpPtr& arg : args )
             Check( *arg );
 
         // Look up the function definition, which might be overloaded.
-        const std::string& funcName = exp.GetFuncName();
-        const FuncDef* funcDef  = findFunc( funcName, args );
+        Symbol         funcName = exp.GetFuncName();
+        const FuncDef* funcDef  = m_funcIndex.Find( funcName, args );
         if( !funcDef )
             // TODO: better error message, including candidates.
-            throw TypeError( std::string( "No match for function: " ) + funcName );
+            throw TypeError( "No match for function: " + funcName.ToString() );
 
-        // Set expression type and link it to the function definition.
+        // Set expression type and link it to the function definition.  Calls to builtin
+        // functions are tagged with an intrinsic opcode for the benefit of the code generator.
         exp.SetType( funcDef->GetReturnType() );
         exp.SetFuncDef( funcDef );
+        exp.SetIntrinsic( funcDef->GetIntrinsic() );
         return nullptr;
     }
 
   private:
-    const Scope&     m_scope;
-    const FuncTable& m_funcTable;
-
-    // Find a (possibly overloaded) function definition with the specified
-    // name whose parameters match the types of the given arguments.
-    // TODO: generalize this and use it to check for duplicate definitions.
-    const FuncDef* findFunc( std::string name, const std::vector<ExpPtr>& args ) const
-    {
-        auto range = m_funcTable.equal_range( name );
-        for( auto it = range.first; it != range.second; ++it )
-        {
-            const FuncDef* funcDef = it->second;
-            if (argsMatch(funcDef->GetParams(), args))
-                return funcDef;
-        }
-        return nullptr;
-    }
-
-    // Check whether the given function parameters match the given argument types.
-    static bool argsMatch( const std::vector<VarDeclPtr>& params, const std::vector<ExpPtr>& args )
-    {
-        if( params.size() != args.size() )
-            return false;
-        for( size_t i = 0; i < params.size(); ++i )
-        {
-            if( params[i]->GetType() != args[i]->GetType() )
-                return false;
-        }
-        return true;
-    }
+    const Scope&         m_scope;
+    const OverloadIndex& m_funcIndex;
 };
 
 
-// The statement typechecker holds a scope and a function table, along with a pointer to the current function
+// The statement typechecker holds a scope and a function index, along with a pointer to the current function
 // (for typechecking return statements). The scope is extended as nested lexical scopes are encountered.
 class StmtTypechecker : public StmtVisitor
 {
   public:
-    StmtTypechecker( Scope* scope, const FuncTable& funcTable, const FuncDef& enclosingFunction )
+    StmtTypechecker( Scope* scope, const OverloadIndex& funcIndex, const FuncDef& enclosingFunction )
         : m_scope( scope )
-        , m_funcTable( funcTable )
+        , m_funcIndex( funcIndex )
         , m_enclosingFunction( enclosingFunction )
+        , m_numSlots( static_cast<int>( enclosingFunction.GetParams().size() ) )
     {
     }
 
+    // Get the number of variable slots used so far (by the parameters and local variables).
+    int GetNumSlots() const { return m_numSlots; }
+
     
     // Helper routine to typecheck a sub-statement.  The visitor operates on
     // non-const expressions, so we must const_cast when dispatching.
@@ -154,8 +135,8 @@ class StmtTypechecker : public StmtVisitor
 
     // Helper routine to typecheck an expression.  We construct an expression
     // typechecker on the fly (which is cheap) that contains the current scope
-    // and function table.
-    void CheckExp( const Exp& exp ) const { ExpTypechecker( *m_scope, m_funcTable ).Check( exp ); }
+    // and function index.
+    void CheckExp( const Exp& exp ) const { ExpTypechecker( *m_scope, m_funcIndex ).Check( exp ); }
 
     // Typecheck a function call statement.
     void Visit( CallStmt& stmt ) override { CheckExp( stmt.GetCallExp() ); }
@@ -167,18 +148,18 @@ class StmtTypechecker : public StmtVisitor
         CheckExp( stmt.GetRvalue() );
 
         // Look up the declaration of the variable on the left hand side of the assignment.
-        const std::string& varName = stmt.GetVarName();
-        const VarDecl*     varDecl = m_scope->Find( varName );
+        Symbol         varName = stmt.GetVarName();
+        const VarDecl* varDecl = m_scope->Find( varName );
         if( !varDecl )
-            throw TypeError( std::string( "Undefined variable in assignment: " ) + varName );
+            throw TypeError( "Undefined variable in assignment: " + varName.ToString() );
 
         // Check that the type of the rvalue matches the lvalue.
         if( varDecl->GetType() != stmt.GetRvalue().GetType() )
-            throw TypeError( std::string( "Type mismatch in assignment to " ) + varName );
+            throw TypeError( "Type mismatch in assignment to " + varName.ToString() );
 
         // Prohibit assignment to function parameters.
         if( varDecl->GetKind() != VarDecl::kLocal )
-            throw TypeError( std::string( "Expected local variable in assignment to " ) + varName );
+            throw TypeError( "Expected local variable in assignment to " + varName.ToString() );
 
         // Link the assignment to the variable declaration.
         stmt.SetVarDecl( varDecl );
@@ -189,17 +170,21 @@ class StmtTypechecker : public StmtVisitor
     {
         // Add the variable declaration to the current scope.  Declaring the same variable twice in
         // a given scope is prohibited.
-        const VarDecl*     varDecl = stmt.GetVarDecl();
-        const std::string& varName = varDecl->GetName();
+        VarDecl* varDecl = stmt.GetVarDecl();
+        Symbol   varName = varDecl->GetName();
         if( !m_scope->Insert( varDecl ) )
-            throw TypeError( std::string( "Variable already defined in this scope: " ) + varName );
+            throw TypeError( "Variable already defined in this scope: " + varName.ToString() );
+
+        // Give the variable the next slot in the enclosing function, which the code generator uses
+        // to find its storage.
+        varDecl->SetSlot( m_numSlots++ );
 
         // Typecheck the initializer expression (if any) and verify that its type matches the declaration.
         if( stmt.HasInitExp() )
         {
             CheckExp( stmt.GetInitExp() );
             if( stmt.GetInitExp().GetType() != varDecl->GetType() )
-                throw TypeError( std::string( "Type mismatch in initialization of " ) + varName );
+                throw TypeError( "Type mismatch in initialization of " + varName.ToString() );
         }
         
     }
@@ -216,10 +201,8 @@ class StmtTypechecker : public StmtVisitor
     // Typecheck a sequence of statements in a nested lexical scope.
     void Visit( SeqStmt& seq ) override
     {
-        // Create a nested scope for any local variable declarations, saving the parent scope.
-        Scope* parentScope = m_scope;
-        Scope  localScope( parentScope );
-        m_scope = &localScope;
+        // Enter a nested scope for any local variable declarations.
+        m_scope->Push();
 
         // Typecheck each statement in the sequence
         for( const StmtPtr& stmt : seq.Get() )
@@ -227,8 +210,8 @@ class StmtTypechecker : public StmtVisitor
             CheckStmt( *stmt );
         }
 
-        // Restore the parent scope.
-        m_scope = parentScope;
+        // Exit the nested scope, restoring any variables its declarations shadowed.
+        m_scope->Pop();
     }
 
     // Typecheck an "if" statement.
@@ -263,52 +246,143 @@ class StmtTypechecker : public StmtVisitor
     }
 
   private:
-    Scope*           m_scope;
-    const FuncTable& m_funcTable;
-    const FuncDef&   m_enclosingFunction;
+    Scope*               m_scope;
+    const OverloadIndex& m_funcIndex;
+    const FuncDef&       m_enclosingFunction;
+    int                  m_numSlots;
 };
 
 
-// Typecheck a function definition, adding it to the given function table.
-void checkFunction( FuncDef* funcDef, FuncTable* funcTable )
+// Typecheck a function definition against the given function index, which already contains
+// every function in the program.  The given scope table is reused for each function.
+void checkFunction( FuncDef* funcDef, const OverloadIndex& funcIndex, Scope* scope )
 {
-    // To permit recursion, we add the definition to the function table
-    // before typechecking the body.  TODO: check for duplicate definitions.
-    funcTable->insert( FuncTable::value_type( funcDef->GetName(), funcDef ) );
-
-    // Construct a scope and add the function parameters.
-    Scope scope;
-    for( const VarDeclPtr& param : funcDef->GetParams() )
+    // Enter the function scope (discarding any scopes left by a type error) and add the function
+    // parameters, which occupy the first variable slots.
+    scope->Clear();
+    scope->Push();
+    const ArenaArray<VarDeclPtr>& params = funcDef->GetParams();
+    for( size_t i = 0; i < params.size(); ++i )
     {
-        if( !scope.Insert( param.get() ) )
-            throw TypeError( "Parameter already defined: " + param->GetName() );
+        if( !scope->Insert( params[i] ) )
+            throw TypeError( "Parameter already defined: " + params[i]->GetName().ToString() );
+        params[i]->SetSlot( static_cast<int>( i ) );
     }
 
-    // Typecheck the function body.
+    // Typecheck the function body, which numbers the local variables.
+    StmtTypechecker checker( scope, funcIndex, *funcDef );
     if( funcDef->HasBody() )
-        StmtTypechecker( &scope, *funcTable, *funcDef ).CheckStmt( funcDef->GetBody() );
+        checker.CheckStmt( funcDef->GetBody() );
+    funcDef->SetNumSlots( checker.GetNumSlots() );
+    scope->Pop();
 }
 
+// The first type error in a program, identified by the index of the function in which it occurred.
+class FirstError
+{
+  public:
+    FirstError()
+        : m_index( SIZE_MAX )
+    {
+    }
+
+    // Get the index of the function with the first error found so far (SIZE_MAX if none).
+    size_t GetIndex() const { return m_index.load( std::memory_order_relaxed ); }
+
+    // Record an error in the function with the given index, unless an earlier one was already found.
+    void Set( size_t index, const std::string& message )
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if( index < m_index )
+        {
+            m_index   = index;
+            m_message = message;
+        }
+    }
+
+    // Get the message of the first error.
+    const std::string& GetMessage() const { return m_message; }
+
+  private:
+    std::atomic<size_t> m_index;
+    std::mutex          m_mutex;
+    std::string         m_message;
+};
+
 } // anonymous namespace
 
 
 // Typecheck a program, returning zero for success.  If a TypeError exception
 // is caught, an error message is reported and a non-zero value is returned.
-int Typecheck( Program& program )
+//
+// Typechecking has two phases.  First the signature of every function is added
+// to the function index, which permits recursion and calls to functions that are
+// defined later.  Then the function bodies are checked.  Each one modifies only
+// its own syntax, so the (now read-only) index can be shared by several threads,
+// which check contiguous ranges of functions (a few ranges per thread).  If
+// several functions have errors, the one that occurs first in the program is
+// reported, as it would be by a sequential typechecker.
+int Typecheck( Program& program, const OverloadIndex& builtins, int numThreads )
 {
-    FuncTable funcTable;
-
-    for( const FuncDefPtr& funcDef : program.GetFunctions() )
+    // The builtin declarations are indexed once, and their index is the parent of the program's
+    // index.  A function may not be defined twice with the same parameter types (including a
+    // builtin).  Each function is numbered by its position, which the code generator uses to find
+    // its LLVM function.
+    OverloadIndex funcIndex( &builtins );
+    funcIndex.Reserve( program.GetFunctions().size() );
+    try
     {
-        try
+        for( size_t i = 0; i < program.GetFunctions().size(); ++i )
         {
-            checkFunction( funcDef.get(), &funcTable );
+            FuncDef* funcDef = program.GetFunctions()[i];
+            funcDef->SetIndex( static_cast<int>( i ) );
+            if( !funcIndex.Insert( funcDef ) )
+                throw TypeError( "Function already defined: " + funcDef->GetName().ToString() );
         }
-        catch( const TypeError& e )
+    }
+    catch( const TypeError& e )
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    // Check the functions in the given range, stopping at the first error (or when an error has
+    // been found in an earlier function).
+    const std::vector<FuncDefPtr>& functions = program.GetFunctions();
+    FirstError                     firstError;
+    auto checkRange = [&]( size_t begin, size_t end ) {
+        Scope scope;
+        for( size_t i = begin; i < end && i < firstError.GetIndex(); ++i )
         {
-            std::cerr << "Error: " << e.what() << std::endl;
-            return -1;
+            try
+            {
+                checkFunction( functions[i], funcIndex, &scope );
+            }
+            catch( const TypeError& e )
+            {
+                firstError.Set( i, e.what() );
+                return;
+            }
         }
+    };
+
+    const size_t kRangesPerThread = 4;
+    size_t numRanges = std::min( functions.size(), numThreads > 1 ? numThreads * kRangesPerThread : 1 );
+    if( numRanges <= 1 )
+        checkRange( 0, functions.size() );
+    else
+    {
+        llvm::DefaultThreadPool pool( llvm::hardware_concurrency( numThreads ) );
+        for( size_t range = 0; range < numRanges; ++range )
+            pool.async( checkRange, functions.size() * range / numRanges,
+                        functions.size() * ( range + 1 ) / numRanges );
+        pool.wait();
+    }
+
+    if( firstError.GetIndex() != SIZE_MAX )
+    {
+        std::cerr << "Error: " << firstError.GetMessage() << std::endl;
+        return -1;
     }
     return 0;
 }
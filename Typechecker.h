@@ -1,5 +1,6 @@
 #pragma once
 
+class OverloadIndex;
 class Program;
 
 /// Typecheck the given program.  Reports an error and returns a non-zero
@@ -7,7 +8,10 @@ class Program;
 /// expression with its type, and it resolves lexical scoping, linking
 /// variable references and function calls to the corresponding definitions.
 /// This allows subsequent passes (e.g. Codegen) to operate without any
-/// knowledge of scoping rules.
-int Typecheck( Program& program );
+/// knowledge of scoping rules.  Calls may refer to the given index of builtin
+/// declarations (\see GetBuiltinIndex), which is not modified.  Functions may
+/// be called before they are defined.  The function bodies are checked on the
+/// given number of threads, but the first error in the program is reported.
+int Typecheck( Program& program, const OverloadIndex& builtins, int numThreads = 1 );
 
 
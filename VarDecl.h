@@ -1,10 +1,10 @@
 #pragma once
 
+#include "Symbol.h"
+#include "Syntax.h"
 #include "Type.h"
 #include <cassert>
 #include <iostream>
-#include <memory>
-#include <string>
 
 /// Variable declaration syntax.  VarDecl is used to represent function
 /// parameters (\see FuncDef) and local variable declarations (\see DeclStmt).
@@ -22,10 +22,11 @@ class VarDecl
     /// Construct a variable declaration of the specified kind with the given
     /// type and name.  Note that the initializer for a local variable is not
     /// part of the declaration; it is stored in the DeclStmt.
-    VarDecl( Kind kind, Type type, const std::string& name )
+    VarDecl( Kind kind, Type type, Symbol name )
         : m_kind( kind )
         , m_type( type )
         , m_name( name )
+        , m_slot( -1 )
     {
     }
 
@@ -36,17 +37,22 @@ class VarDecl
     const Type& GetType() const { return m_type; }
 
     /// Get the variable name.
-    const std::string& GetName() const { return m_name; }
+    Symbol GetName() const { return m_name; }
+
+    /// Get the variable's slot, which is a dense index among the variables of the enclosing
+    /// function (parameters first), assigned by the typechecker.  Returns -1 if it is unassigned.
+    int GetSlot() const { return m_slot; }
+
+    /// Set the variable's slot.  \see GetSlot
+    void SetSlot( int slot ) { m_slot = slot; }
 
   private:
     Kind         m_kind;
     Type         m_type;
-    std::string  m_name;
+    Symbol       m_name;
+    int          m_slot;
 };
 
-/// Unique pointer to variable declaration.
-using VarDeclPtr = std::unique_ptr<VarDecl>;
-
 /// Output a variable declaration.
 inline std::ostream& operator<<( std::ostream& out, const VarDecl& varDecl )
 {
@@ -1,28 +1,21 @@
-#include "Builtins.h"
-#include "Codegen.h"
-#include "FuncDef.h"
-#include "Parser.h"
-#include "Printer.h"
-#include "Program.h"
-#include "SimpleJIT.h"
-#include "TokenStream.h"
-#include "Typechecker.h"
+#include "BatchIO.h"
+#include "CompileStats.h"
+#include "Compiler.h"
 
-#include <llvm/IR/PassManager.h>
-#include <llvm/IR/LLVMContext.h>
-#include <llvm/IR/Module.h>
-#include <llvm/IR/Verifier.h>
-#include <llvm/Passes/PassBuilder.h>
-#include <llvm/Support/raw_os_ostream.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
 #include <llvm/Support/raw_ostream.h>
-#include <llvm/Target/TargetMachine.h>
-#include <llvm/Support/TargetSelect.h>
-#include <llvm/MC/TargetRegistry.h>
-#include <llvm/TargetParser/Host.h>
 
-#include <fstream>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #ifndef OPT_LEVEL
 /// Optimization level, which defaults to -O2.
@@ -30,230 +23,230 @@
 #endif
 
 namespace {
-    
-// Forward declarations.
-void optimize( Module* module, int optLevel );
-int  readFile( const char* filename, std::vector<char>* buffer );
-void dumpSyntax( const Program& program, const char* srcFilename );
-void dumpIR( llvm::Module& module, const char* srcFilename, const char* what );
 
-// Parse and typecheck the given source code, adding definitions to the given Program.
-// This is used to process both builtin definitions and user code.
-int parseAndTypecheck( const char* source, Program* program )
+// Command-line options.  The compiler options are given to the Compiler; the rest control how the
+// compiled program is called.
+struct Options
 {
-    // Construct token stream, which encapsulates the lexer.  \see TokenStream.
-    TokenStream tokens( source );
+    Options() { compiler.optLevel = OPT_LEVEL; }
+
+    CompilerOptions compiler;
+    const char*     filename   = nullptr;  // source file (or "-" for stdin)
+    int             inputValue = 0;
+    const char*     inputsPath = nullptr;  // file of input values (or "-" for stdin) for batch mode
+    bool            binary     = false;    // batch inputs and results are binary rather than text
+    int             numWorkers = 1;        // number of threads that evaluate batch inputs
+    bool            batchEntry = true;     // generate main_batch for batch mode, unless --no-batch-entry
+    bool            timeReport = false;    // print compilation statistics to stderr (-ftime-report)
+    const char*     statsPath  = nullptr;  // write compilation statistics to this JSON file (--stats=<file>)
+    bool            stream     = false;    // lex the source as it is read, rather than mapping it (--stream)
+};
+
+// Parse command-line options, which precede the filename and input value (which is omitted in
+// batch mode).  A lone "-" is not an option: it denotes stdin.  Returns false if the command line
+// is malformed.
+bool parseOptions( int argc, const char* const* argv, Options* options )
+{
+    CompilerOptions& compiler = options->compiler;
+    int i = 1;
+    for( ; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; ++i )
+    {
+        std::string arg( argv[i] );
+        if( arg == "-O0" ) compiler.optLevel = 0;
+        else if( arg == "-O1" ) compiler.optLevel = 1;
+        else if( arg == "-O2" ) compiler.optLevel = 2;
+        else if( arg == "-O3" ) compiler.optLevel = 3;
+        else if( arg == "-j" && i + 1 < argc && atoi( argv[i + 1] ) > 0 )
+            compiler.numThreads = atoi( argv[++i] );
+        else if( arg == "--lazy" )
+            compiler.lazy = true;
+        else if( arg == "--tiered" )
+            compiler.tiered = true;
+        else if( arg.compare( 0, 6, "-mcpu=" ) == 0 )
+            compiler.cpu = arg.substr( 6 );
+        else if( arg.compare( 0, 7, "-mattr=" ) == 0 )
+            compiler.features = arg.substr( 7 );
+        else if( arg.compare( 0, 12, "--cache-dir=" ) == 0 )
+            compiler.cacheDir = arg.substr( 12 );
+        else if( arg == "--inputs" && i + 1 < argc )
+            options->inputsPath = argv[++i];
+        else if( arg == "--binary" )
+            options->binary = true;
+        else if( arg == "--workers" && i + 1 < argc && atoi( argv[i + 1] ) > 0 )
+            options->numWorkers = atoi( argv[++i] );
+        else if( arg == "--no-batch-entry" )
+            options->batchEntry = false;
+        else if( arg == "-ftime-report" )
+            options->timeReport = true;
+        else if( arg.compare( 0, 8, "--stats=" ) == 0 )
+            options->statsPath = argv[i] + 8;
+        else if( arg == "--stream" )
+            options->stream = true;
+        else if( arg == "--no-simplify" )
+            compiler.simplify = false;
+        else
+        {
+            std::cerr << "Invalid option: " << arg << std::endl;
+            return false;
+        }
+    }
+    compiler.collectStats = options->timeReport || options->statsPath;
+    if( options->inputsPath )
+    {
+        if( argc - i != 1 )
+            return false;
+        options->filename = argv[i];
+        compiler.batchEntry = options->batchEntry;
+        if( std::string( options->filename ) == "-" && std::string( options->inputsPath ) == "-" )
+        {
+            std::cerr << "The source and the inputs cannot both be read from stdin" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    if( argc - i != 2 )
+        return false;
+    options->filename   = argv[i];
+    options->inputValue = atoi( argv[i + 1] );
+    return true;
+}
 
-    // Parse the token stream into a program.
-    int status = ParseProgram( tokens, program );
+// Call the main function on each input value in the file specified by the command-line options,
+// writing the results to stdout.  Returns zero for success.
+int runBatch( MainFunc mainFunc, BatchFunc batchFunc, const Options& options )
+{
+    bool       isStdin = std::string( options.inputsPath ) == "-";
+    std::FILE* in      = isStdin ? stdin : std::fopen( options.inputsPath, options.binary ? "rb" : "r" );
+    if( !in )
+    {
+        std::cerr << "Unable to open inputs file: " << options.inputsPath << std::endl;
+        return -1;
+    }
+#ifdef _WIN32
+    if( options.binary )
+    {
+        _setmode( _fileno( stdout ), _O_BINARY );
+        if( isStdin )
+            _setmode( _fileno( stdin ), _O_BINARY );
+    }
+#endif
 
-    // If the parser succeeded, typecheck the program.
-    if( status == 0 )
-        status = Typecheck( *program );
+    IntReader reader( in, options.binary );
+    IntWriter writer( stdout, options.binary );
+    int       status = RunBatch( mainFunc, batchFunc, reader, writer, options.numWorkers );
+    if( !isStdin )
+        std::fclose( in );
     return status;
 }
 
+// Report the compilation statistics, if requested, as a table on stderr and/or as JSON in a file.
+// Returns zero for success.
+int reportStats( const CompiledProgram& program, const Options& options )
+{
+    const CompileStats* stats = program.GetStats();
+    if( !stats )
+        return 0;
+    if( options.timeReport )
+        stats->PrintTable( llvm::errs() );
+    if( options.statsPath )
+    {
+        std::error_code      error;
+        llvm::raw_fd_ostream out( options.statsPath, error, llvm::sys::fs::OF_Text );
+        if( error )
+        {
+            std::cerr << "Unable to write statistics: " << options.statsPath << std::endl;
+            return -1;
+        }
+        stats->PrintJSON( out );
+    }
+    return 0;
+}
+
 } // anonymous namespace
 
 
 int main( int argc, const char* const* argv )
 {
-    // Initialize LLVM target infrastructure early
-    SimpleJIT::initializeLLVM();
-    
     // Get command-line arguments.
-    if( argc < 3 || argc > 4 )
+    Options options;
+    if( !parseOptions( argc, argv, &options ) )
     {
-        std::cerr << "Usage: " << argv[0] << " [-O0|-O1|-O2|-O3] <filename> <inputValue>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [options] <filename|-> <inputValue>" << std::endl;
+        std::cerr << "       " << argv[0] << " [options] --inputs <file|-> <filename|->" << std::endl;
+        std::cerr << "  A filename of \"-\" reads the source from stdin, lexing it as it is read" << std::endl;
         std::cerr << "  -O0: no optimization, -O1: basic, -O2: default, -O3: aggressive" << std::endl;
+        std::cerr << "  -j <N>: parse, generate and optimize code using N threads" << std::endl;
+        std::cerr << "  -mcpu=<cpu>: generate code for the given CPU (default \"native\", the host CPU;" << std::endl;
+        std::cerr << "               \"generic\" for code and cached objects that do not depend on the host)" << std::endl;
+        std::cerr << "  -mattr=<+feature,-feature,...>: enable or disable target features" << std::endl;
+        std::cerr << "  --lazy: compile each function on demand, when it is first called" << std::endl;
+        std::cerr << "  --tiered: compile at -O0, then recompile hot functions at -O3 in the background" << std::endl;
+        std::cerr << "  --cache-dir=<dir>: cache compiled code in the given directory (ignored with --lazy or --tiered)" << std::endl;
+        std::cerr << "  --inputs <file|->: call main on each integer in the file (or stdin), printing the results" << std::endl;
+        std::cerr << "  --binary: batch inputs and results are 32-bit binary integers rather than text" << std::endl;
+        std::cerr << "  --workers <N>: call main from N threads in batch mode (results remain in order)" << std::endl;
+        std::cerr << "  --no-batch-entry: call main once per input in batch mode, rather than a vectorizable loop" << std::endl;
+        std::cerr << "  -ftime-report: print the time of each compilation phase and optimization pass" << std::endl;
+        std::cerr << "  --stats=<file>: write compilation times and counters to the given JSON file" << std::endl;
+        std::cerr << "  --stream: lex the source file as it is read, rather than mapping it into memory (no caching)" << std::endl;
+        std::cerr << "  --no-simplify: generate code for constant expressions and branches, rather than folding them" << std::endl;
         return -1;
     }
-    
-    // Parse optimization level and arguments
-    int optLevel = OPT_LEVEL; // default
-    const char* filename;
-    int inputValue;
-    
-    if( argc == 3 ) {
-        // No optimization flag provided, use default
-        filename = argv[1];
-        inputValue = atoi( argv[2] );
-    } else {
-        // Optimization flag provided
-        std::string optArg = argv[1];
-        if( optArg == "-O0" ) optLevel = 0;
-        else if( optArg == "-O1" ) optLevel = 1;
-        else if( optArg == "-O2" ) optLevel = 2;
-        else if( optArg == "-O3" ) optLevel = 3;
-        else {
-            std::cerr << "Invalid optimization level: " << optArg << std::endl;
-            std::cerr << "Use -O0, -O1, -O2, or -O3" << std::endl;
+    const char* filename = options.filename;
+    Compiler    compiler( options.compiler );
+    std::unique_ptr<CompiledProgram> program;
+    if( options.stream || std::string( filename ) == "-" )
+    {
+        // Compile the source as it is read from the file (or stdin), which need not be seekable.
+        bool       isStdin = std::string( filename ) == "-";
+        std::FILE* file    = isStdin ? stdin : std::fopen( filename, "rb" );
+        if( !file )
+        {
+            std::cerr << "Unable to open input file: " << filename << std::endl;
             return -1;
         }
-        filename = argv[2];
-        inputValue = atoi( argv[3] );
+        program = compiler.Compile( file, isStdin ? "<stdin>" : filename );
+        if( !isStdin )
+            std::fclose( file );
     }
-
-    // Read source file.  TODO: use an input stream, rather than reading the entire file.
-    std::vector<char> source;
-    int status = readFile( filename, &source );
-    if( status != 0 )
+    else
     {
-        std::cerr << "Unable to open input file: " << filename << std::endl;
-        return status;
+        // Load source file, which is mapped into memory rather than copied if it is large.
+        std::unique_ptr<llvm::MemoryBuffer> source;
+        int status = ReadSourceFile( filename, &source );
+        if( status != 0 )
+        {
+            std::cerr << "Unable to open input file: " << filename << std::endl;
+            return status;
+        }
+        program = compiler.Compile( source->getBufferStart(), filename );
     }
 
-    // Parse and typecheck builtin functions.
-    ProgramPtr  program( new Program );
-    status = parseAndTypecheck( GetBuiltins(), program.get() );
-    assert(status == 0);
-
-    // Parse and typecheck user source code.
-    status = parseAndTypecheck( source.data(), program.get());
-    if( status )
-        return status;
-    dumpSyntax( *program, filename );
-
-    // Generate LLVM IR.
-    llvm::LLVMContext context;
-    std::unique_ptr<llvm::Module> module( Codegen( &context, *program ) );
-    dumpIR( *module, filename, "initial" );
-
-    // Verify the module, which catches malformed instructions and type errors.
-    assert(!verifyModule(*module, &llvm::errs()));
-
-    // Construct JIT engine.
-    SimpleJIT jit;
-    // Note: Data layout is automatically handled by LLJIT in LLVM 19
-
-    // Optimize the module.
-    optimize( module.get(), optLevel );
-    dumpIR( *module, filename, "optimized" );
-
-    // Use the JIT engine to generate native code.
-    auto addResult = jit.addModule( std::move(module) );
-    if (addResult) {
-        std::cerr << "Failed to add module to JIT: " << toString(std::move(addResult)) << std::endl;
+    // Errors have already been reported if compilation failed.
+    if( !program )
         return -1;
-    }
 
-    // Get the main function pointer.
-    auto mainSymbolResult = jit.findSymbol( "main" );
-    if (!mainSymbolResult) {
-        std::cerr << "Failed to find main symbol: " << toString(mainSymbolResult.takeError()) << std::endl;
+    // Get the main function pointer.  The JIT generates code when it is first looked up, so the
+    // statistics are reported afterwards.
+    MainFunc mainFunc = program->GetMain();
+    if( !mainFunc )
+    {
+        std::cerr << "Failed to find main symbol" << std::endl;
         return -1;
     }
-    
-    typedef int ( *MainFunc )( int );
-    MainFunc mainFunc = reinterpret_cast<MainFunc>( mainSymbolResult->getValue() );
+    BatchFunc batchFunc = options.inputsPath ? program->GetMainBatch() : nullptr;
+    int status = reportStats( *program, options );
+    if( status != 0 )
+        return status;
+
+    // In batch mode, call the main function on each input value, writing the results to stdout.
+    // The batch entry point is used if it was generated (main might not have the expected type).
+    if( options.inputsPath )
+        return runBatch( mainFunc, batchFunc, options );
 
     // Call the main function using the input value from the command line.
-    int result = mainFunc(inputValue);
+    int result = mainFunc(options.inputValue);
     std::cout << result << std::endl;
     
     return 0;
 }
-
-namespace {
-
-// Optimize the module using the given optimization level (0 - 3).
-void optimize( Module* module, int optLevel )
-{
-    // Ensure LLVM target infrastructure is initialized
-    SimpleJIT::initializeLLVM();
-    
-    // Skip optimization for O0
-    if (optLevel == 0) {
-        return;
-    }
-    
-    // Create a simple target machine for optimization
-    auto targetTriple = llvm::sys::getDefaultTargetTriple();
-    std::string error;
-    auto target = llvm::TargetRegistry::lookupTarget(targetTriple, error);
-    if (!target) {
-        llvm::errs() << "Warning: Could not find target for optimization: " << error << "\n";
-        return;
-    }
-    
-    auto targetMachine = target->createTargetMachine(
-        targetTriple, "generic", "", llvm::TargetOptions{}, std::nullopt);
-    if (!targetMachine) {
-        llvm::errs() << "Warning: Could not create target machine for optimization\n";
-        return;
-    }
-    
-    // Create analysis managers
-    llvm::LoopAnalysisManager LAM;
-    llvm::FunctionAnalysisManager FAM;
-    llvm::CGSCCAnalysisManager CGAM;
-    llvm::ModuleAnalysisManager MAM;
-    
-    // Create pass builder with target machine
-    llvm::PipelineTuningOptions PTO;
-    llvm::PassBuilder PB(targetMachine, PTO);
-    
-    // Register analysis managers in the correct order (from LLVM opt tool)
-    PB.registerModuleAnalyses(MAM);
-    PB.registerCGSCCAnalyses(CGAM);
-    PB.registerFunctionAnalyses(FAM);
-    PB.registerLoopAnalyses(LAM);
-    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
-    
-    // Configure optimization level
-    llvm::OptimizationLevel level;
-    switch(optLevel) {
-        case 1: level = llvm::OptimizationLevel::O1; break;
-        case 2: level = llvm::OptimizationLevel::O2; break;
-        case 3: level = llvm::OptimizationLevel::O3; break;
-        default: level = llvm::OptimizationLevel::O2; break;
-    }
-    
-    // Build and run the optimization pipeline
-    llvm::ModulePassManager MPM = PB.buildPerModuleDefaultPipeline(level);
-    MPM.run(*module, MAM);
-}
-
-// Read file into the given buffer.  Returns zero for success.
-int readFile( const char* filename, std::vector<char>* buffer )
-{
-    // Open the stream at the end, get file size, and allocate data.
-    std::ifstream in( filename, std::ifstream::ate | std::ifstream::binary );
-    if( in.fail() )
-        return -1;
-    size_t length = static_cast<size_t>( in.tellg() );
-
-    buffer->resize( length + 1 );
-
-    // Rewind and read entire file
-    in.clear();  // clear EOF
-    in.seekg( 0, std::ios::beg );
-    in.read( buffer->data(), length );
-
-    // The buffer is null-terminated (for the benefit of the Lexer).
-    (*buffer)[length] = '\0';
-    return 0;
-}
-
-// Dump syntax for debugging if the "ENABLE_DUMP" environment variable is set.
-void dumpSyntax( const Program& program, const char* srcFilename )
-{
-    if ( !getenv("ENABLE_DUMP") )
-        return;
-    std::string   filename( std::string( srcFilename ) + ".syn" );
-    std::ofstream out( filename );
-    out << program << std::endl;
-}
-
-// Dump LLVM IR for debugging if the "ENABLE_DUMP" environment variable is set.
-void dumpIR( llvm::Module& module, const char* srcFilename, const char* what )
-{
-    if ( !getenv("ENABLE_DUMP") )
-        return;
-    std::string   filename( std::string( srcFilename ) + "." + what + ".ll" );
-    std::ofstream stream( filename );
-    llvm::raw_os_ostream out( stream );
-    out << module;
-}
-
-} // anonymous namespace